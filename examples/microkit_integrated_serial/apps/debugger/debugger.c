@@ -9,177 +9,125 @@
 #include <microkit.h>
 #include <stddef.h>
 #include <gdb.h>
+#include <transport.h>
 #include <util.h>
 
-/* Input buffer */
-static char input[BUFSIZE];
+/* The UART is interrupt driven, so the debugger only runs when GDB has sent something or the
+   UART needs more output, rather than spinning on the status register */
+#define UART_IRQ_CH 0
 
-/* Output buffer */
+#define NUM_DEBUGEES 2
+
+/* libgdb's state, and that of the transport layer on top of it */
+static gdb_ctx_t ctx;
+static gdb_transport_ctx_t tctx;
+
+/* Output buffer for registering the initial threads */
 static char output[BUFSIZE];
 
-#define NUM_DEBUGEES 2
+/* Output that didn't fit in the UART's tx ring buffer, kept in order until the TX interrupt says
+   the ring has drained. Free running indices, so that head == tail means empty. */
+#define TX_BACKLOG_SIZE (4 * BUFSIZE)
+static char tx_backlog[TX_BACKLOG_SIZE];
+static uint32_t tx_backlog_head = 0;
+static uint32_t tx_backlog_tail = 0;
 
 // @alwin: Do we really want this in here? The GDB library relies on printf, but I think that dependency should be removed
 void _putchar(char character) {
     microkit_dbg_putc(character);
 }
 
-static char *get_packet(void) {
-    char c;
-    int count;
-    /* Checksum and expected checksum */
-    unsigned char cksum, xcksum;
-    char *buf = input;
-    (void) buf;
-
-    while (1) {
-        /* Wait for the start character - ignoring all other characters */
-        while ((c = uart_get_char()) != '$')
-#ifndef DEBUG_PRINTS
-            ;
-#else
-        {
-            uart_put_char(c);
-        }
-        uart_put_char(c);
-#endif
-        retry:
-        /* Initialize cksum variables */
-        cksum = 0;
-        xcksum = -1;
-        count = 0;
-        (void) xcksum;
-
-        /* Read until we see a # or the buffer is full */
-        while (count < BUFSIZE - 1) {
-            c = uart_get_char();
-#ifdef DEBUG_PRINTS
-            uart_put_char(c);
-#endif
-            if (c == '$') {
-                goto retry;
-            } else if (c == '#') {
-                break;
-            }
-            cksum += c;
-            buf[count++] = c;
-        }
-
-        /* Null terminate the string */
-        buf[count] = 0;
-
-#ifdef DEBUG_PRINTS
-        printf("\nThe value of the command so far is %s. The checksum you should enter is %x\n", buf, cksum);
-#endif
-
-        if (c == '#') {
-            c = uart_get_char();
-            xcksum = hexchar_to_int(c) << 4;
-            c = uart_get_char();
-            xcksum += hexchar_to_int(c);
-
-            if (cksum != xcksum) {
-                uart_put_char('-');   /* checksum failed */
-            } else {
-                uart_put_char('+');   /* checksum success, ack*/
-
-                if (buf[2] == ':') {
-                    uart_put_char(buf[0]);
-                    uart_put_char(buf[1]);
-
-                    return &buf[3];
-                }
-
-                return buf;
-            }
-        }
-    }
-
-    return NULL;
+/* Packets are framed straight out of the UART's rx ring buffer */
+static char *uart_recv_peek(void *cookie, uint32_t *len) {
+    return uart_rx_peek(len);
 }
 
-/*
- * Send a packet, computing it's checksum, waiting for it's acknoledge.
- * If there is not ack, packet will be resent.
- */
-static void put_packet(char *buf)
-{
-    uint8_t cksum;
-    for (;;) {
-        uart_put_char('$');
-        for (cksum = 0; *buf; buf++) {
-            cksum += *buf;
-            uart_put_char(*buf);
-        }
-        uart_put_char('#');
-        uart_put_char(int_to_hexchar(cksum >> 4));
-        uart_put_char(int_to_hexchar(cksum % 16));
-        char c = uart_get_char();
-        if (c == '+') break;
-    }
+static void uart_recv_consume(void *cookie, uint32_t len) {
+    uart_rx_consume(len);
 }
 
-// Suspend all the child protection domains
-static void suspend_system() {
-    // @alwin: There is no guarantee the debugees have consecutive IDs starting
-    // from zero
-    for (int i = 0; i < NUM_DEBUGEES; i++) {
-        seL4_TCB_Suspend(BASE_TCB_CAP + i);
+/* Queue output for the UART. Whatever doesn't fit in the tx ring buffer goes in the backlog and is
+   sent from the TX interrupt, so packets are never cut short and nothing here waits on the UART. */
+static void uart_send(void *cookie, const char *buf, uint32_t len) {
+    uint32_t sent = (tx_backlog_head == tx_backlog_tail) ? uart_write(buf, len) : 0;
+
+    assert(len - sent <= TX_BACKLOG_SIZE - (tx_backlog_tail - tx_backlog_head));
+    for (; sent < len; sent++) {
+        tx_backlog[tx_backlog_tail % TX_BACKLOG_SIZE] = buf[sent];
+        tx_backlog_tail++;
     }
 }
 
-// Resume all the child protection domains
-static void resume_system() {
-    for (int i = 0; i < 64; i++) {
-        if (!inferiors[i].enabled) break;
-        if (inferiors[i].wakeup) {
-            seL4_TCB_Resume(BASE_TCB_CAP + i);
+/* Move as much of the backlog as fits into the tx ring buffer. While any is left the ring is full,
+   so the UART keeps its TX interrupt on and this runs again once the ring has drained. */
+static void send_backlog(void) {
+    while (tx_backlog_head != tx_backlog_tail) {
+        uint32_t offset = tx_backlog_head % TX_BACKLOG_SIZE;
+        uint32_t avail = tx_backlog_tail - tx_backlog_head;
+        uint32_t len = (avail < TX_BACKLOG_SIZE - offset) ? avail : TX_BACKLOG_SIZE - offset;
+        uint32_t sent = uart_write(&tx_backlog[offset], len);
+        tx_backlog_head += sent;
+        if (sent < len) {
+            break;
         }
     }
 }
 
-void gdb_event_loop() {
-    cont_type_t ctype = ctype_dont;
-    while (ctype == ctype_dont) {
-        char *input = get_packet();
-        ctype = gdb_handle_packet(input, output);
-        if (ctype != ctype_dont) break;
-        put_packet(output);
-    }
-
-    resume_system();
+/* uart_write starts transmitting straight away */
+static void uart_flush(void *cookie) {
 }
 
-void init() {
-    suspend_system();
+static gdb_transport_t uart_transport = {
+    .cookie = NULL,
+    .recv_peek = uart_recv_peek,
+    .recv_consume = uart_recv_consume,
+    .send = uart_send,
+    .flush = uart_flush,
+};
 
-	uart_init();
+void init() {
+    gdb_ctx_init(&ctx);
+    gdb_transport_ctx_init(&tctx, &ctx);
 
+    /* Register all of the inferiors  */
     for (int i = 0; i < NUM_DEBUGEES; i++) {
-        gdb_register_inferior(i, BASE_TCB_CAP + i, BASE_VSPACE_CAP + i);
+        gdb_register_inferior(&ctx, i, BASE_VSPACE_CAP + i);
+        gdb_register_thread(&ctx, i, 0, BASE_TCB_CAP + i, output);
     }
 
-    /* Wait for a connection to be established */
-    gdb_event_loop();
+    /* First, we suspend all the debugeee PDs*/
+    suspend_system(&ctx);
+
+    uart_irq_init();
+
+    /* Everything else happens as GDB sends us packets */
+    gdb_transport_init(&tctx, 0, &uart_transport);
 }
 
-void fault(microkit_channel ch, microkit_msginfo msginfo) {
-    int n_reply = 0;
-    // @alwin: i think this parameter no longer really works with the current model
-    seL4_Word reply_mr;
+seL4_Bool fault(microkit_child ch, microkit_msginfo msginfo, microkit_msginfo *reply_msginfo) {
+    // @alwin: I'm not entirely convinced there is a point having reply_mr here still
+    bool have_reply;
+    DebuggerError err = gdb_transport_fault(&tctx, ch, 0, microkit_msginfo_get_label(msginfo), &have_reply);
+    if (err) {
+        microkit_dbg_puts("GDB: Internal assertion failed. Could not find faulting thread");
+    }
 
-    suspend_system();
-    bool reply = gdb_handle_fault(ch, microkit_msginfo_get_label(msginfo), &reply_mr, output);
-    put_packet(output);
-    if (reply) {
-        microkit_fault_reply(microkit_msginfo_new(0, 0));
+    if (have_reply) {
+        *reply_msginfo = microkit_msginfo_new(0, 0);
+        return true;
     }
 
-    gdb_event_loop();
+    return false;
 }
 
 void notified(microkit_channel ch) {
-    // @alwin: when the user enters ctrl-c in GDB, the ctrl-c character (ascii 3) is sent through UART. We should capture this and enter the event loop
-    // This would require making the driver interrupt driven.
-    gdb_event_loop();
-}
\ No newline at end of file
+    if (ch != UART_IRQ_CH) {
+        return;
+    }
+
+    uart_handle_irq();
+    send_backlog();
+    microkit_irq_ack(ch);
+
+    gdb_transport_poll(&tctx, 0);
+}
@@ -1,18 +1,51 @@
 #include <microkit.h>
+#include <stdint.h>
 
 #define UART_OFFSET 0x4c0
 #define UART_WFIFO  0x0
 #define UART_RFIFO  0x4
 #define UART_CTRL 0x8
 #define UART_STATUS 0xC
+#define UART_MISC 0x10
 
+#define UART_TX_EMPTY       (1 << 22)
 #define UART_TX_FULL        (1 << 21)
 #define UART_RX_EMPTY       (1 << 20)
+#define UART_TX_COUNT(status) (((status) >> 8) & 0x7f)
 #define UART_CONTROL_TX_ENABLE   (1 << 12)
+#define UART_CONTROL_RX_ENABLE   (1 << 13)
+#define UART_CONTROL_RX_INT_ENABLE (1 << 27)
+#define UART_CONTROL_TX_INT_ENABLE (1 << 28)
+
+/* The number of characters in the FIFOs at which the UART interrupts */
+#define UART_MISC_TX_IRQ_CNT(n) (((n) & 0xff) << 8)
+#define UART_MISC_RX_IRQ_CNT(n) ((n) & 0xff)
+
+#define UART_FIFO_SIZE 64
 
 #define REG_PTR(base, offset) ((volatile uint32_t *)((base) + (offset)))
 
 void uart_init();
 void uart_put_char(int ch);
 void uart_put_str(char *str);
-int uart_get_char();
\ No newline at end of file
+int uart_get_char();
+
+/*
+ * Interrupt driven interface. Received characters are moved out of the RX FIFO into a ring buffer,
+ * and transmitted characters are put in a ring buffer that is used to keep the TX FIFO topped up,
+ * so nothing here ever waits on the UART. uart_handle_irq must be called whenever the UART's IRQ
+ * comes in (and the IRQ acked afterwards).
+ */
+#define UART_RING_SIZE 4096
+
+void uart_irq_init();
+void uart_handle_irq();
+
+/* Get the received characters that are contiguous in the ring buffer without copying them, or
+   NULL if there are none. uart_rx_consume marks len of them as used. */
+char *uart_rx_peek(uint32_t *len);
+void uart_rx_consume(uint32_t len);
+
+/* Queue characters to be transmitted. Returns the number queued, which is less than len if the
+   ring buffer filled up. */
+uint32_t uart_write(const char *buf, uint32_t len);
@@ -1,8 +1,19 @@
 
+#include <stddef.h>
 #include "include/uart.h"
 
 uintptr_t uart_base_vaddr;
 
+typedef struct uart_ring {
+    /* Free running indices, so that head == tail means empty */
+    uint32_t head;
+    uint32_t tail;
+    char buf[UART_RING_SIZE];
+} uart_ring_t;
+
+static uart_ring_t rx_ring;
+static uart_ring_t tx_ring;
+
 void uart_init() {
     *REG_PTR(uart_base_vaddr + UART_OFFSET, UART_CTRL) |= UART_CONTROL_TX_ENABLE;
 }
@@ -29,3 +40,76 @@ void uart_put_str(char *str) {
         str++;
     }
 }
+
+void uart_irq_init() {
+    rx_ring.head = rx_ring.tail = 0;
+    tx_ring.head = tx_ring.tail = 0;
+
+    /* Interrupt on every received character, and when the TX FIFO drops to a quarter full so it
+       can be refilled before it runs dry */
+    *REG_PTR(uart_base_vaddr + UART_OFFSET, UART_MISC) = UART_MISC_TX_IRQ_CNT(UART_FIFO_SIZE / 4) |
+                                                        UART_MISC_RX_IRQ_CNT(1);
+    *REG_PTR(uart_base_vaddr + UART_OFFSET, UART_CTRL) |= UART_CONTROL_TX_ENABLE | UART_CONTROL_RX_ENABLE |
+                                                        UART_CONTROL_RX_INT_ENABLE;
+}
+
+/* Move as much as will fit from the tx ring into the TX FIFO. The TX interrupt is only left on
+   while there is still something waiting to go in. */
+static void uart_fill_tx_fifo() {
+    volatile uint32_t *ctrl = REG_PTR(uart_base_vaddr + UART_OFFSET, UART_CTRL);
+    uint32_t status = *REG_PTR(uart_base_vaddr + UART_OFFSET, UART_STATUS);
+    uint32_t space = (status & UART_TX_FULL) ? 0 : UART_FIFO_SIZE - UART_TX_COUNT(status);
+
+    while (space > 0 && tx_ring.head != tx_ring.tail) {
+        *REG_PTR(uart_base_vaddr + UART_OFFSET, UART_WFIFO) = tx_ring.buf[tx_ring.head % UART_RING_SIZE];
+        tx_ring.head++;
+        space--;
+    }
+
+    if (tx_ring.head != tx_ring.tail) {
+        *ctrl |= UART_CONTROL_TX_INT_ENABLE;
+    } else {
+        *ctrl &= ~UART_CONTROL_TX_INT_ENABLE;
+    }
+}
+
+void uart_handle_irq() {
+    /* Drain the RX FIFO. If the ring is full, the rest are dropped and GDB will resend them. */
+    while (!(*REG_PTR(uart_base_vaddr + UART_OFFSET, UART_STATUS) & UART_RX_EMPTY)) {
+        char c = *REG_PTR(uart_base_vaddr + UART_OFFSET, UART_RFIFO);
+        if (rx_ring.tail - rx_ring.head < UART_RING_SIZE) {
+            rx_ring.buf[rx_ring.tail % UART_RING_SIZE] = c;
+            rx_ring.tail++;
+        }
+    }
+
+    uart_fill_tx_fifo();
+}
+
+char *uart_rx_peek(uint32_t *len) {
+    if (rx_ring.head == rx_ring.tail) {
+        return NULL;
+    }
+
+    uint32_t offset = rx_ring.head % UART_RING_SIZE;
+    uint32_t avail = rx_ring.tail - rx_ring.head;
+    *len = (avail < UART_RING_SIZE - offset) ? avail : UART_RING_SIZE - offset;
+    return &rx_ring.buf[offset];
+}
+
+void uart_rx_consume(uint32_t len) {
+    rx_ring.head += len;
+}
+
+uint32_t uart_write(const char *buf, uint32_t len) {
+    uint32_t i;
+    for (i = 0; i < len && tx_ring.tail - tx_ring.head < UART_RING_SIZE; i++) {
+        tx_ring.buf[tx_ring.tail % UART_RING_SIZE] = buf[i];
+        tx_ring.tail++;
+    }
+
+    /* Start transmitting straight away rather than waiting for an interrupt */
+    uart_fill_tx_fifo();
+
+    return i;
+}
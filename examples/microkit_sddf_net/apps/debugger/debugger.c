@@ -3,348 +3,104 @@
  * SPDX-License-Identifier: BSD-2-Clause
  */
 
-#include <microkit.h>
-
-
 #include <stdbool.h>
 #include <stdint.h>
 #include <microkit.h>
 #include <sddf/util/util.h>
-#include <sddf/util/string.h>
 #include <sddf/util/printf.h>
-#include <sddf/network/lib_sddf_lwip.h>
-#include <sddf/network/queue.h>
-#include <sddf/network/config.h>
-#include <sddf/serial/queue.h>
-#include <sddf/serial/config.h>
-#include <sddf/timer/client.h>
-#include <sddf/timer/config.h>
-#include <sddf/benchmark/sel4bench.h>
-#include <sddf/benchmark/config.h>
-#include "lwip/pbuf.h"
-#include <libco.h>
 #include <gdb.h>
+#include <transport.h>
 
 #include "tcp.h"
-#include "char_queue.h"
-
-serial_queue_handle_t serial_tx_queue_handle;
-
-__attribute__((__section__(".serial_client_config"))) serial_client_config_t serial_config;
-
-__attribute__((__section__(".timer_client_config"))) timer_client_config_t timer_config;
-
-__attribute__((__section__(".net_client_config"))) net_client_config_t net_config;
-
-__attribute__((__section__(".lib_sddf_lwip_config"))) lib_sddf_lwip_config_t lib_sddf_lwip_config;
-
-
-typedef enum event_state {
-    eventState_none = 0,
-    eventState_waitingForInputEventLoop,
-    eventState_waitingForInputFault
-} event_state_t;
-event_state_t state = eventState_none;
-static bool detached = false;
-
-cothread_t t_event, t_main, t_fault;
+#include "net_stack.h"
 
-#define STACK_SIZE 4096
-static char t_main_stack[STACK_SIZE];
-static char t_fault_stack[STACK_SIZE];
+/* libgdb's state, and that of the transport layer on top of it */
+static gdb_ctx_t ctx;
+static gdb_transport_ctx_t tctx;
 
-char_queue_t tcp_input_queue = {
-    .tail = 0,
-    .head = 0,
-    .buf = {0}
-};
-char input[BUFSIZE];
-
-/* Output buffer */
+/* Output buffer for registering the initial threads */
 static char output[BUFSIZE];
-static char tcp_output_buf[BUFSIZE];
-
-net_queue_handle_t net_rx_handle;
-net_queue_handle_t net_tx_handle;
-
-struct pbuf *head;
-struct pbuf *tail;
 
-#define LWIP_TICK_MS 100
-
-static int socket_fd;
-static int socket_fd;
-bool tcp_initialized = false;
-static bool debugger_initialized = false;
+/* Whether each session has a connection to its GDB */
+static bool session_initialized[NUM_SESSIONS];
 
 #define NUM_DEBUGEES 2
 
+#if NUM_SESSIONS > MAX_SESSIONS
+#error "NUM_SESSIONS is larger than libgdb supports"
+#endif
+
 void _putchar(char character) {
     microkit_dbg_putc(character);
 }
 
-/**
- * Netif status callback function that output's client's Microkit name and
- * obtained IP address.
- *
- * @param ip_addr ip address of the client.
- */
-void netif_status_callback(char *ip_addr)
-{
-    sddf_printf("DHCP request finished, IP address for netif %s is: %s\n", microkit_name, ip_addr);
-}
-
-/**
- * Stores a pbuf to be transmitted upon available transmit buffers.
- *
- * @param p pbuf to be stored.
- */
-net_sddf_err_t enqueue_pbufs(struct pbuf *p)
-{
-    /* Indicate to the tx virt that we wish to be notified about free tx buffers */
-    net_request_signal_free(&net_tx_handle);
-
-    if (head == NULL) {
-        head = p;
-    } else {
-        tail->next_chain = p;
-    }
-    tail = p;
-
-    /* Increment reference count to ensure this pbuf is not freed by lwip */
-    pbuf_ref(p);
-
-    return SDDF_LWIP_ERR_OK;
-}
-
-/**
- * Sets a timeout for the next lwip tick.
- */
-void set_timeout(void)
-{
-    sddf_timer_set_timeout(timer_config.driver_id, LWIP_TICK_MS * NS_IN_MS);
-}
-
-void transmit(void)
-{
-    bool reprocess = true;
-    while (reprocess) {
-        while (head != NULL && !net_queue_empty_free(&net_tx_handle)) {
-            net_sddf_err_t err = sddf_lwip_transmit_pbuf(head);
-            if (err == SDDF_LWIP_ERR_PBUF) {
-                sddf_dprintf("LWIP|ERROR: attempted to send a packet of size %u > BUFFER SIZE %u\n", head->tot_len,
-                             NET_BUFFER_SIZE);
-            } else if (err != SDDF_LWIP_ERR_OK) {
-                sddf_dprintf("LWIP|ERROR: unkown error when trying to send pbuf %p\n", head);
-            }
-
-            struct pbuf *temp = head;
-            head = temp->next_chain;
-            if (head == NULL) {
-                tail = NULL;
-            }
-            pbuf_free(temp);
-        }
-
-        /* Only request a signal if there are more pending pbufs to send */
-        if (head == NULL || !net_queue_empty_free(&net_tx_handle)) {
-            net_cancel_signal_free(&net_tx_handle);
-        } else {
-            net_request_signal_free(&net_tx_handle);
-        }
-        reprocess = false;
-
-        if (head != NULL && !net_queue_empty_free(&net_tx_handle)) {
-            net_cancel_signal_free(&net_tx_handle);
-            reprocess = true;
-        }
-    }
-}
-
-char gdb_get_char(event_state_t new_state) {
-    while (char_queue_empty(&tcp_input_queue, tcp_input_queue.head)) {
-        // Wait for the virt to tell us some input has come through
-        state = new_state;
-        co_switch(t_event);
-    }
-
-    char c;
-    char_dequeue(&tcp_input_queue, &c);
-    return c;
+/* The cookie is the session, which is also the index of its TCP connection */
+static char *net_recv_peek(void *cookie, uint32_t *len) {
+    uint16_t len16;
+    char *data = tcp_recv_peek((uintptr_t) cookie, &len16);
+    *len = len16;
+    return data;
 }
 
-char *get_packet(event_state_t new_state) {
-    char c;
-    int count;
-    /* Checksum and expected checksum */
-    unsigned char cksum, xcksum;
-    char *buf = input;
-    (void) buf;
-
-    while (1) {
-        /* Wait for the start character - ignoring all other characters */
-        c = gdb_get_char(new_state);
-        while (c != '$') {
-            /* Ctrl-C character - should result in an interrupt */
-            if (c == 3) {
-                buf[0] = c;
-                buf[1] = 0;
-                return buf;
-            }
-            c = gdb_get_char(new_state);
-        }
-        retry:
-        /* Initialize cksum variables */
-        cksum = 0;
-        xcksum = -1;
-        count = 0;
-
-        /* Read until we see a # or the buffer is full */
-        while (count < BUFSIZE - 1) {
-            c = gdb_get_char(new_state);
-
-            if (c == '$') {
-                goto retry;
-            } else if (c == '#') {
-                break;
-            }
-            cksum += c;
-            buf[count++] = c;
-        }
-
-        /* Null terminate the string */
-        buf[count] = 0;
-
-        if (c == '#') {
-            c = gdb_get_char(new_state);
-            xcksum = hexchar_to_int(c) << 4;
-            c = gdb_get_char(new_state);
-            xcksum += hexchar_to_int(c);
-
-            if (cksum != xcksum) {
-                tcp_send("-", 1);
-            } else {
-                tcp_send("+", 1);
-
-                if (buf[2] == ':') {
-                    tcp_send(&input[1], 1);
-                    tcp_send(&input[2], 1);
-
-                    return &buf[3];
-                }
-
-                return buf;
-            }
-        }
-    }
-
-    return NULL;
+static void net_recv_consume(void *cookie, uint32_t len) {
+    tcp_recv_consume((uintptr_t) cookie, len);
 }
 
-int put_packet(char *output, event_state_t new_state) {
-    uint8_t cksum;
-    char *tcp_output_tmp = tcp_output_buf;
-    for (;;) {
-        *(tcp_output_tmp++) = '$';
-        for (cksum = 0; *output; tcp_output_tmp++, output++) {
-            cksum += *output;
-            *tcp_output_tmp = *output;
-        }
-        *(tcp_output_tmp++) = '#';
-        *(tcp_output_tmp++) = int_to_hexchar(cksum >> 4);
-        *(tcp_output_tmp++) = int_to_hexchar(cksum % 16);
-        *(tcp_output_tmp++) = 0;
-        tcp_send(tcp_output_buf, strnlen(tcp_output_buf, BUFSIZE));
-        char c = gdb_get_char(new_state);
-        if (c == '+') break;
-    }
+static void net_send(void *cookie, const char *buf, uint32_t len) {
+    tcp_queue((uintptr_t) cookie, buf, len);
 }
 
-void event_loop(){
-    bool resume = false;
-    while (1) {
-        char *input = get_packet(eventState_waitingForInputEventLoop);
-        if (detached || input[0] == 3) {
-            /* If we got a ctrl-c packet, we should suspend the whole system */
-            suspend_system();
-            detached = false;
-        }
-
-        resume = gdb_handle_packet(input, output, &detached);
-
-        if (!resume || detached) {
-            put_packet(output, eventState_waitingForInputEventLoop);
-        }
-
-        if (resume) {
-            resume_system();
-        }
-    }
+static void net_flush(void *cookie) {
+    tcp_flush((uintptr_t) cookie);
 }
 
-
-err_t gdb_connected() {
-    /* Set up the coroutines */
-    t_event = co_active();
-    t_main = co_derive((void *) t_main_stack, STACK_SIZE, event_loop);
-
-    /* We have accepted a connection, so we are ready */
-    debugger_initialized = true;
-    co_switch(t_main);
-}
+/* Packets are framed straight out of the pbufs lwIP received them in, and everything libgdb sends in
+   response to them goes out with a single tcp_output. Each GDB session gets its own connection. */
+static gdb_transport_t net_transports[NUM_SESSIONS];
 
 void init(void)
 {
+    gdb_ctx_init(&ctx);
+    gdb_transport_ctx_init(&tctx, &ctx);
+
     /* Register all the debugee PDs */
     for (int i = 0; i < NUM_DEBUGEES; i++) {
-        gdb_register_inferior(i, BASE_VSPACE_CAP + i);
-        gdb_register_thread(i, 0, BASE_TCB_CAP + i, output);
+        gdb_register_inferior(&ctx, i, BASE_VSPACE_CAP + i);
+        gdb_register_thread(&ctx, i, 0, BASE_TCB_CAP + i, output);
+        /* With several GDB sessions, the debugees are shared out between them */
+        gdb_assign_inferior(&ctx, i, i % NUM_SESSIONS);
     }
 
-    /* Suspend all the debugee PDs */
-    suspend_system();
-
-    serial_queue_init(&serial_tx_queue_handle, serial_config.tx.queue.vaddr, serial_config.tx.data.size,
-                  serial_config.tx.data.vaddr);
-    serial_putchar_init(serial_config.tx.id, &serial_tx_queue_handle);
-
-    net_queue_init(&net_rx_handle, net_config.rx.free_queue.vaddr, net_config.rx.active_queue.vaddr,
-                   net_config.rx.num_buffers);
-    net_queue_init(&net_tx_handle, net_config.tx.free_queue.vaddr, net_config.tx.active_queue.vaddr,
-                   net_config.tx.num_buffers);
-    net_buffers_init(&net_tx_handle, 0);
-
-    sddf_lwip_init(&lib_sddf_lwip_config, &net_config, &timer_config, net_rx_handle, net_tx_handle, NULL,
-                   netif_status_callback, enqueue_pbufs);
-    set_timeout();
-
-    setup_tcp_socket();
+    for (int i = 0; i < NUM_SESSIONS; i++) {
+        net_transports[i] = (gdb_transport_t) {
+            .cookie = (void *) (uintptr_t) i,
+            .recv_peek = net_recv_peek,
+            .recv_consume = net_recv_consume,
+            .send = net_send,
+            .flush = net_flush,
+        };
+    }
 
-    sddf_lwip_maybe_notify();
-}
+    /* Suspend all the debugee PDs. suspend_system only stops the selected session's inferiors. */
+    for (int i = 0; i < NUM_SESSIONS; i++) {
+        gdb_select_session(&ctx, i);
+        suspend_system(&ctx);
+    }
+    gdb_select_session(&ctx, 0);
 
-void fault_message() {
-    put_packet(output, eventState_waitingForInputFault);
-    // Go back to waiting for normal input after we send the fault packet to the host
-    state = eventState_waitingForInputEventLoop;
-    co_switch(t_event);
+    net_stack_init();
 }
 
 seL4_Bool fault(microkit_child ch, microkit_msginfo msginfo, microkit_msginfo *reply_msginfo) {
-    seL4_Word reply_mr = 0;
-
-    suspend_system();
-
+    /* Stops and console output are held on to by libgdb until GDB has connected */
     bool have_reply;
-    DebuggerError err = gdb_handle_fault(ch, 0, microkit_msginfo_get_label(msginfo), &reply_mr, output, &have_reply);
+    DebuggerError err = gdb_transport_fault(&tctx, ch, 0, microkit_msginfo_get_label(msginfo), &have_reply);
     if (err) {
         microkit_dbg_puts("GDB: Internal assertion failed. Could not find faulting thread");
     }
 
-    // Start a coroutine for dealing with the fault and transmitting a message to the host
-    t_event = co_active();
-    t_fault = co_derive((void *) t_fault_stack, STACK_SIZE, fault_message);
-    co_switch(t_fault);
+    /* Anything sent to GDB has to be pushed out of lwIP */
+    net_stack_output();
 
     if (have_reply) {
         *reply_msginfo = microkit_msginfo_new(0, 0);
@@ -355,35 +111,23 @@ seL4_Bool fault(microkit_child ch, microkit_msginfo msginfo, microkit_msginfo *r
 }
 
 void notified(microkit_channel ch) {
-    if (ch == net_config.rx.id) {
-        sddf_lwip_process_rx();
-        if (debugger_initialized) {
-            if (state == eventState_waitingForInputFault) {
-                state = eventState_none;
-                co_switch(t_fault);
-            }
-
-            /* This is not an else if because we want to switch to the event loop after
-               handling the fault message. We could probably do this unconditionally?  */
-            if (state == eventState_waitingForInputEventLoop) {
-                state = eventState_none;
-                co_switch(t_main);
-            }
-        }
-    } else if (ch == net_config.tx.id) {
-        transmit();
-    } else if (ch == timer_config.driver_id) {
-        sddf_lwip_process_timeout();
-        set_timeout();
-    } else if (ch == serial_config.tx.id) {
-        // Nothing to do
-    } else {
+    if (!net_stack_notified(ch)) {
         sddf_dprintf("LWIP|LOG: received notification on unexpected channel: %u\n", ch);
     }
 
-    if (tcp_initialized && !debugger_initialized) {
-        gdb_connected();
+    for (int i = 0; i < NUM_SESSIONS; i++) {
+        if (tcp_accepted(i)) {
+            /* We have accepted a connection, so this session starts over with a fresh link */
+            gdb_transport_init(&tctx, i, &net_transports[i]);
+            session_initialized[i] = true;
+        } else if (session_initialized[i] && !tcp_connected(i)) {
+            /* GDB has gone away. Anything sent before it reconnects is dropped by tcp_queue. */
+            session_initialized[i] = false;
+        }
+
+        /* Deal with anything GDB has sent us */
+        gdb_transport_poll(&tctx, i);
     }
 
-    sddf_lwip_maybe_notify();
+    net_stack_output();
 }
@@ -0,0 +1,176 @@
+/*
+ * Copyright 2025, UNSW
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <microkit.h>
+#include <gdb.h>
+#include <transport.h>
+#include <util.h>
+
+#include "rsp_rings.h"
+
+/*
+ * The debugger PD for the split configuration. The network PD terminates the TCP connection, so all
+ * this does is handle faults and packets, with the RSP byte stream coming in and out of shared rings.
+ */
+
+/* Set by Microkit */
+uintptr_t to_debugger_ring_vaddr;
+uintptr_t to_gdb_ring_vaddr;
+
+static spsc_ring_handle_t to_debugger;
+static spsc_ring_handle_t to_gdb;
+
+/* Whether the network PD needs to be told that we have sent something or made room in its ring */
+static bool net_pd_pending = false;
+
+/* Output that didn't fit in the to_gdb ring, which is sent once the network PD has made space for it.
+   The transport never has more than an unacked packet, a notification and a few acks waiting to go
+   out, so this cannot fill up. */
+#define TX_BACKLOG_SIZE (4 * BUFSIZE)
+static char tx_backlog[TX_BACKLOG_SIZE];
+static uint32_t tx_backlog_len = 0;
+
+/* libgdb's state, and that of the transport layer on top of it */
+static gdb_ctx_t ctx;
+static gdb_transport_ctx_t tctx;
+
+/* Output buffer for registering the initial threads */
+static char output[BUFSIZE];
+
+#define NUM_DEBUGEES 2
+
+void _putchar(char character) {
+    microkit_dbg_putc(character);
+}
+
+/* Packets are framed straight out of the shared ring */
+static char *ring_recv_peek(void *cookie, uint32_t *len) {
+    return spsc_ring_peek(&to_debugger, len);
+}
+
+static void ring_recv_consume(void *cookie, uint32_t len) {
+    spsc_ring_consume(&to_debugger, len);
+    net_pd_pending = true;
+}
+
+/* Move as much of the backlog into the ring as fits. If some is left, the network PD is asked to
+   notify us once it has consumed from the ring. */
+static void send_backlog(void) {
+    /* The network PD notifies us once it has dropped the output for the last connection */
+    if (spsc_ring_reset_pending(&to_gdb)) {
+        return;
+    }
+
+    uint32_t sent = spsc_ring_write(&to_gdb, tx_backlog, tx_backlog_len);
+    if (sent < tx_backlog_len) {
+        spsc_ring_request_space_signal(&to_gdb);
+        sent += spsc_ring_write(&to_gdb, tx_backlog + sent, tx_backlog_len - sent);
+    }
+
+    memmove(tx_backlog, tx_backlog + sent, tx_backlog_len - sent);
+    tx_backlog_len -= sent;
+    if (sent != 0) {
+        net_pd_pending = true;
+    }
+}
+
+/* Whatever doesn't fit in the ring is kept in order and sent later, so packets are never cut short */
+static void ring_send(void *cookie, const char *buf, uint32_t len) {
+    bool can_write = (tx_backlog_len == 0 && !spsc_ring_reset_pending(&to_gdb));
+    uint32_t sent = can_write ? spsc_ring_write(&to_gdb, buf, len) : 0;
+    if (sent != 0) {
+        net_pd_pending = true;
+    }
+    if (sent == len) {
+        return;
+    }
+
+    assert(len - sent <= TX_BACKLOG_SIZE - tx_backlog_len);
+    memcpy(tx_backlog + tx_backlog_len, buf + sent, len - sent);
+    tx_backlog_len += len - sent;
+    send_backlog();
+}
+
+/* One notification covers everything sent and consumed since the last one */
+static void ring_flush(void *cookie) {
+    if (net_pd_pending) {
+        net_pd_pending = false;
+        microkit_notify(RSP_NET_PD_CH);
+    }
+}
+
+static gdb_transport_t ring_transport = {
+    .cookie = NULL,
+    .recv_peek = ring_recv_peek,
+    .recv_consume = ring_recv_consume,
+    .send = ring_send,
+    .flush = ring_flush,
+};
+
+/* GDB has connected or gone away, so the link starts over the way it does in debugger.c. Whatever was
+   on its way in either direction belonged to the last connection. */
+static void start_over(void) {
+    tx_backlog_len = 0;
+    spsc_ring_request_reset(&to_gdb);
+    spsc_ring_take_reset(&to_debugger);
+    net_pd_pending = true;
+
+    gdb_transport_init(&tctx, 0, &ring_transport);
+}
+
+void init(void)
+{
+    spsc_ring_init(&to_debugger, (void *) to_debugger_ring_vaddr, RSP_RING_REGION_SIZE);
+    spsc_ring_init(&to_gdb, (void *) to_gdb_ring_vaddr, RSP_RING_REGION_SIZE);
+
+    gdb_ctx_init(&ctx);
+    gdb_transport_ctx_init(&tctx, &ctx);
+
+    /* Register all the debugee PDs */
+    for (int i = 0; i < NUM_DEBUGEES; i++) {
+        gdb_register_inferior(&ctx, i, BASE_VSPACE_CAP + i);
+        gdb_register_thread(&ctx, i, 0, BASE_TCB_CAP + i, output);
+    }
+
+    /* Suspend all the debugee PDs */
+    suspend_system(&ctx);
+}
+
+seL4_Bool fault(microkit_child ch, microkit_msginfo msginfo, microkit_msginfo *reply_msginfo) {
+    /* Stops and console output are held on to by libgdb until GDB has connected */
+    bool have_reply;
+    DebuggerError err = gdb_transport_fault(&tctx, ch, 0, microkit_msginfo_get_label(msginfo), &have_reply);
+    if (err) {
+        microkit_dbg_puts("GDB: Internal assertion failed. Could not find faulting thread");
+    }
+
+    if (have_reply) {
+        *reply_msginfo = microkit_msginfo_new(0, 0);
+        return true;
+    }
+
+    return false;
+}
+
+void notified(microkit_channel ch) {
+    if (ch != RSP_NET_PD_CH) {
+        return;
+    }
+
+    /* The network PD only forwards anything once GDB has connected, and we have started over */
+    if (spsc_ring_reset_pending(&to_debugger)) {
+        start_over();
+    }
+
+    if (tx_backlog_len != 0) {
+        send_backlog();
+    }
+
+    gdb_transport_poll(&tctx, 0);
+}
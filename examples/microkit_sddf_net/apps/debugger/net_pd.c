@@ -0,0 +1,137 @@
+/*
+ * Copyright 2025, UNSW
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <microkit.h>
+#include <sddf/util/util.h>
+#include <sddf/util/printf.h>
+
+#include "tcp.h"
+#include "net_stack.h"
+#include "rsp_rings.h"
+
+/*
+ * The network PD for the split configuration. This runs lwIP and the TCP connection to GDB, and just
+ * moves bytes between the connection and the rings shared with the debugger PD. The debugger PD is
+ * then free to handle faults while we process packets, and the two can run on different cores.
+ */
+
+/* Set by Microkit */
+uintptr_t to_debugger_ring_vaddr;
+uintptr_t to_gdb_ring_vaddr;
+
+static spsc_ring_handle_t to_debugger;
+static spsc_ring_handle_t to_gdb;
+
+/* Whether GDB was connected when we last looked, to notice it connecting or going away */
+static bool was_connected = false;
+
+void _putchar(char character) {
+    microkit_dbg_putc(character);
+}
+
+/* Move what GDB has sent into the ring for the debugger. Anything that doesn't fit stays in the
+   pbufs, which keeps the TCP window closed until the debugger catches up. */
+static void forward_to_debugger(void)
+{
+    bool forwarded = false;
+    uint16_t len;
+    char *data;
+    while ((data = tcp_recv_peek(0, &len)) != NULL) {
+        uint32_t written = spsc_ring_write(&to_debugger, data, len);
+        if (written == 0) {
+            break;
+        }
+
+        tcp_recv_consume(0, written);
+        forwarded = true;
+    }
+
+    if (forwarded) {
+        microkit_notify(RSP_DEBUGGER_CH);
+    }
+}
+
+/* Move what the debugger has sent into lwIP. Only as much as fits in lwIP's send buffer is queued at
+   once, and the rest stays in the ring until lwIP has sent some of it and we are notified again. */
+static void forward_to_gdb(void)
+{
+    bool consumed = false;
+    uint32_t len;
+    char *data;
+    while ((data = spsc_ring_peek(&to_gdb, &len)) != NULL) {
+        len = MIN(len, tcp_send_space(0));
+        if (len == 0 || tcp_queue(0, data, len)) {
+            break;
+        }
+
+        spsc_ring_consume(&to_gdb, len);
+        consumed = true;
+    }
+
+    tcp_flush(0);
+
+    /* The debugger may be holding on to output until there is space in the ring */
+    if (consumed && spsc_ring_take_space_signal(&to_gdb)) {
+        microkit_notify(RSP_DEBUGGER_CH);
+    }
+}
+
+/* Throw away what the debugger has sent while nobody is connected to take it, as tcp_queue would */
+static void drop_to_gdb(void)
+{
+    uint32_t len = spsc_ring_length(&to_gdb);
+    if (len == 0) {
+        return;
+    }
+
+    spsc_ring_consume(&to_gdb, len);
+    if (spsc_ring_take_space_signal(&to_gdb)) {
+        microkit_notify(RSP_DEBUGGER_CH);
+    }
+}
+
+void init(void)
+{
+    spsc_ring_init(&to_debugger, (void *) to_debugger_ring_vaddr, RSP_RING_REGION_SIZE);
+    spsc_ring_init(&to_gdb, (void *) to_gdb_ring_vaddr, RSP_RING_REGION_SIZE);
+
+    net_stack_init();
+}
+
+void notified(microkit_channel ch) {
+    if (ch != RSP_DEBUGGER_CH && !net_stack_notified(ch)) {
+        sddf_dprintf("LWIP|LOG: received notification on unexpected channel: %u\n", ch);
+    }
+
+    /* The debugger starts over whenever GDB connects or goes away, so that nothing from one
+       connection is passed on to the next. It drops what is left in to_debugger, and then asks us to
+       drop what is left in to_gdb. */
+    bool connected = tcp_connected(0);
+    if (connected != was_connected) {
+        was_connected = connected;
+        spsc_ring_request_reset(&to_debugger);
+        microkit_notify(RSP_DEBUGGER_CH);
+    }
+
+    if (!spsc_ring_reset_pending(&to_debugger)) {
+        /* The debugger holds on to its output until the old output is gone */
+        if (spsc_ring_take_reset(&to_gdb)) {
+            microkit_notify(RSP_DEBUGGER_CH);
+        }
+
+        /* The debugger may have consumed some of its ring or sent something, and we may have received
+           something from GDB, so always move data both ways */
+        if (connected) {
+            forward_to_debugger();
+            forward_to_gdb();
+        } else {
+            drop_to_gdb();
+        }
+    }
+
+    net_stack_output();
+}
@@ -0,0 +1,22 @@
+/*
+ * Copyright 2025, UNSW
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <microkit.h>
+
+/* The lwIP stack and the sDDF net, timer and serial clients it runs on top of. GDB connects to
+   port 1234 (plus the session number), and tcp.h is used to talk to it once tcp_connected says so.
+   tcp_initialized is set once any connection has been accepted. */
+
+extern bool tcp_initialized;
+
+void net_stack_init(void);
+/* Returns false if the channel isn't one used by the network stack */
+bool net_stack_notified(microkit_channel ch);
+/* Push out anything lwIP has queued for the network. This should be called before going back to
+   waiting for notifications. */
+void net_stack_output(void);
@@ -0,0 +1,17 @@
+/*
+ * Copyright 2025, UNSW
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#pragma once
+
+#include <spsc_ring.h>
+
+/* In the split configuration, the network PD terminates the TCP connection and passes the raw RSP
+   byte stream to and from the debugger PD through a pair of shared rings. These have to match meta.py. */
+
+#define RSP_RING_REGION_SIZE 0x10000
+
+/* The debugger's channel to the network PD, and the network PD's channel to the debugger */
+#define RSP_NET_PD_CH 62
+#define RSP_DEBUGGER_CH 62
@@ -13,29 +13,58 @@
 #include <sddf/util/util.h>
 #include <gdb.h>
 
-#include "char_queue.h"
+#include "tcp.h"
 
-extern char_queue_t tcp_input_queue;
 extern bool tcp_initialized;
 
-static struct tcp_pcb *gdb_pcb;
+/* A connection to one GDB. Each session listens on its own port. */
+typedef struct gdb_conn {
+    struct tcp_pcb *pcb;
+    /* Data received from GDB that hasn't been consumed yet, and how far into the first pbuf we are.
+       Later pbufs are chained on to the end as they arrive. */
+    struct pbuf *rx_pbuf;
+    uint16_t rx_offset;
+    /* Whether data has been queued with tcp_write that hasn't been handed to tcp_output yet */
+    bool tcp_pending;
+    bool connected;
+    /* Whether a connection has been accepted that tcp_accepted hasn't reported yet */
+    bool accepted;
+} gdb_conn_t;
+
+static gdb_conn_t conns[NUM_SESSIONS];
 
 static err_t tcp_sent_gdb(void *arg, struct tcp_pcb *pcb, u16_t len)
 {
-    // tcp_recved is only for increasing the TCP window, and isn't required to
-    // ACK incoming packets (that is done automatically on receive).
-    tcp_recved(pcb, len);
-
     return ERR_OK;
 }
 
+/* Forget about a connection that has gone away. Nothing is sent to GDB until another one is accepted. */
+static void conn_closed(gdb_conn_t *conn)
+{
+    if (conn->rx_pbuf) {
+        pbuf_free(conn->rx_pbuf);
+    }
+    conn->rx_pbuf = NULL;
+    conn->rx_offset = 0;
+    conn->pcb = NULL;
+    conn->tcp_pending = false;
+    conn->connected = false;
+}
+
 static void tcp_err_gdb(void *arg, err_t err)
 {
     sddf_printf("tcp_echo: %s\n", lwip_strerr(err));
+
+    /* lwIP has already freed the pcb */
+    if (arg) {
+        conn_closed(arg);
+    }
 }
 
 static err_t tcp_recv_gdb(void *arg, struct tcp_pcb *pcb, struct pbuf *p, err_t err)
 {
+    gdb_conn_t *conn = arg;
+
     if (p == NULL) {
         // closing
         sddf_printf("tcp_echo[%s:%d]: closing\n",
@@ -43,6 +72,7 @@ static err_t tcp_recv_gdb(void *arg, struct tcp_pcb *pcb, struct pbuf *p, err_t
                    );
 
         tcp_arg(pcb, NULL);
+        conn_closed(conn);
 
         err = tcp_close(pcb);
         if (err) {
@@ -63,41 +93,129 @@ static err_t tcp_recv_gdb(void *arg, struct tcp_pcb *pcb, struct pbuf *p, err_t
         return err;
     }
 
-    char tmp[BUFSIZE];
-    pbuf_copy_partial(p, (void *) tmp, p->tot_len, 0);
+    /* The data is used straight out of the pbufs and they are freed once it has been consumed */
+    if (conn->rx_pbuf) {
+        pbuf_cat(conn->rx_pbuf, p);
+    } else {
+        conn->rx_pbuf = p;
+        conn->rx_offset = 0;
+    }
 
-    /* Null terminate the string*/
-    tmp[p->tot_len] = 0;
+    return ERR_OK;
+}
 
-    char_queue_enqueue_batch(&tcp_input_queue, strnlen(tmp, BUFSIZE), tmp);
+bool tcp_connected(int session) {
+    return conns[session].connected;
+}
 
-    pbuf_free(p);
-    return ERR_OK;
+bool tcp_accepted(int session) {
+    bool accepted = conns[session].accepted;
+    conns[session].accepted = false;
+    return accepted;
+}
+
+char *tcp_recv_peek(int session, uint16_t *len) {
+    gdb_conn_t *conn = &conns[session];
+
+    /* Skip over any empty pbufs */
+    while (conn->rx_pbuf && conn->rx_offset == conn->rx_pbuf->len) {
+        tcp_recv_consume(session, 0);
+    }
+
+    if (conn->rx_pbuf == NULL) {
+        return NULL;
+    }
+
+    *len = conn->rx_pbuf->len - conn->rx_offset;
+    return (char *) conn->rx_pbuf->payload + conn->rx_offset;
+}
+
+void tcp_recv_consume(int session, uint16_t len) {
+    gdb_conn_t *conn = &conns[session];
+
+    conn->rx_offset += len;
+    if (conn->rx_offset < conn->rx_pbuf->len) {
+        return;
+    }
+
+    /* Free the first pbuf of the chain but keep the rest */
+    uint16_t consumed = conn->rx_pbuf->len;
+    struct pbuf *rest = conn->rx_pbuf->next;
+    if (rest) {
+        pbuf_ref(rest);
+    }
+    pbuf_free(conn->rx_pbuf);
+    conn->rx_pbuf = rest;
+    conn->rx_offset = 0;
+
+    /* Only open the window back up once we've actually dealt with the data */
+    if (conn->pcb) {
+        tcp_recved(conn->pcb, consumed);
+    }
+}
+
+uint32_t tcp_send_space(int session) {
+    gdb_conn_t *conn = &conns[session];
+    return (conn->pcb != NULL) ? tcp_sndbuf(conn->pcb) : 0;
 }
 
-int tcp_send(void *buf, uint32_t len) {
-    err_t error = tcp_write(gdb_pcb, buf, len, TCP_WRITE_FLAG_COPY);
+int tcp_queue(int session, const void *buf, uint32_t len) {
+    gdb_conn_t *conn = &conns[session];
+    if (conn->pcb == NULL) {
+        return 0;
+    }
+
+    err_t error = tcp_write(conn->pcb, buf, len, TCP_WRITE_FLAG_COPY);
     if (error) {
         sddf_printf("Failed to send message");
         return 1;
     }
 
-    error = tcp_output(gdb_pcb);
+    conn->tcp_pending = true;
+    return 0;
+}
+
+int tcp_flush(int session) {
+    gdb_conn_t *conn = &conns[session];
+
+    if (!conn->tcp_pending || conn->pcb == NULL) {
+        return 0;
+    }
+
+    conn->tcp_pending = false;
+    err_t error = tcp_output(conn->pcb);
     if (error) {
         sddf_printf("Failed to output message");
+        return 1;
     }
 
     return 0;
 }
 
+int tcp_send(int session, void *buf, uint32_t len) {
+    if (tcp_queue(session, buf, len)) {
+        return 1;
+    }
+
+    return tcp_flush(session);
+}
+
 
 static err_t tcp_accept_gdb(void *arg, struct tcp_pcb *pcb, err_t err)
 {
+    gdb_conn_t *conn = arg;
+
     tcp_nagle_disable(pcb);
+    tcp_arg(pcb, conn);
     tcp_sent(pcb, tcp_sent_gdb);
     tcp_recv(pcb, tcp_recv_gdb);
     tcp_err(pcb, tcp_err_gdb);
-    gdb_pcb = pcb;
+    conn->pcb = pcb;
+    conn->rx_pbuf = NULL;
+    conn->rx_offset = 0;
+    conn->tcp_pending = false;
+    conn->connected = true;
+    conn->accepted = true;
 
     tcp_initialized = true;
 
@@ -107,25 +225,28 @@ static err_t tcp_accept_gdb(void *arg, struct tcp_pcb *pcb, err_t err)
 
 int setup_tcp_socket(void)
 {
-    gdb_pcb = tcp_new_ip_type(IPADDR_TYPE_V4);
-    if (gdb_pcb == NULL) {
-        sddf_printf("Failed to open TCP echo socket\n");
-        return -1;
-    }
+    for (int i = 0; i < NUM_SESSIONS; i++) {
+        struct tcp_pcb *pcb = tcp_new_ip_type(IPADDR_TYPE_V4);
+        if (pcb == NULL) {
+            sddf_printf("Failed to open TCP echo socket\n");
+            return -1;
+        }
 
-    err_t error = tcp_bind(gdb_pcb, IP_ANY_TYPE, 1234);
-    if (error) {
-        sddf_printf("Failed to bind TCP echo socket: %s\n", lwip_strerr(error));
-        return -1;
-    }
+        err_t error = tcp_bind(pcb, IP_ANY_TYPE, GDB_PORT + i);
+        if (error) {
+            sddf_printf("Failed to bind TCP echo socket: %s\n", lwip_strerr(error));
+            return -1;
+        }
 
-    gdb_pcb = tcp_listen_with_backlog_and_err(gdb_pcb, 1, &error);
-    if (error) {
-        sddf_printf("Failed to listen on TCP echo socket: %s\n", lwip_strerr(error));
-        return -1;
-    }
+        pcb = tcp_listen_with_backlog_and_err(pcb, 1, &error);
+        if (error) {
+            sddf_printf("Failed to listen on TCP echo socket: %s\n", lwip_strerr(error));
+            return -1;
+        }
 
-    tcp_accept(gdb_pcb, tcp_accept_gdb);
+        tcp_arg(pcb, &conns[i]);
+        tcp_accept(pcb, tcp_accept_gdb);
+    }
 
     return 0;
 }
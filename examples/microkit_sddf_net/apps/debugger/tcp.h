@@ -6,6 +6,7 @@
 #pragma once
 
 #include <stdint.h>
+#include <stdbool.h>
 
 #include <lwip/dhcp.h>
 #include <lwip/init.h>
@@ -22,4 +23,28 @@
 #define SOCKET_BUF_SIZE 0x200000ll
 #define MAX_SOCKETS 3
 
-int tcp_send(void *buf, uint32_t len);
\ No newline at end of file
+/* Number of GDB instances that can be connected at once. Session n listens on port GDB_PORT + n. */
+#ifndef NUM_SESSIONS
+#define NUM_SESSIONS 1
+#endif
+
+#define GDB_PORT 1234
+
+int setup_tcp_socket(void);
+bool tcp_connected(int session);
+/* Whether a new connection has been accepted for the session since this was last called */
+bool tcp_accepted(int session);
+int tcp_send(int session, void *buf, uint32_t len);
+
+/* Queue data to be sent to GDB without sending it yet, so that an ack and the reply that follows
+   it (or the pieces of a packet) go out together. tcp_flush sends everything that is queued. */
+int tcp_queue(int session, const void *buf, uint32_t len);
+/* How much tcp_queue can take right now */
+uint32_t tcp_send_space(int session);
+int tcp_flush(int session);
+
+/* Get the next contiguous piece of data received from GDB without copying it, or NULL if there
+   is none. It stays valid until it is consumed. */
+char *tcp_recv_peek(int session, uint16_t *len);
+/* Mark len bytes from tcp_recv_peek as used */
+void tcp_recv_consume(int session, uint16_t len);
@@ -86,7 +86,13 @@ BOARDS: List[Board] = [
 ]
 
 
-def generate(sdf_file: str, output_dir: str, dtb: DeviceTree):
+# These have to match apps/debugger/rsp_rings.h
+RSP_RING_REGION_SIZE = 0x10000
+RSP_NET_PD_CH = 62
+RSP_DEBUGGER_CH = 62
+
+
+def generate(sdf_file: str, output_dir: str, dtb: DeviceTree, split: bool):
     uart_node = dtb.node(board.serial)
     assert uart_node is not None
     ethernet_node = dtb.node(board.ethernet)
@@ -109,15 +115,25 @@ def generate(sdf_file: str, output_dir: str, dtb: DeviceTree):
     net_system = Sddf.Net(sdf, ethernet_node, ethernet_driver, net_virt_tx, net_virt_rx)
 
     debugger = ProtectionDomain("debugger", "debugger.elf", priority=97, budget=20000, stack_size=0x20000)
-    debugger_net_copier = ProtectionDomain(
-        "debugger_net_copier", "network_copy.elf", priority=98, budget=20000
+
+    # In the split configuration, a separate network PD runs lwIP and terminates the TCP connection,
+    # and the debugger only handles faults and RSP packets, which it gets through shared rings.
+    if split:
+        net_client_name = "net_pd"
+        net_client = ProtectionDomain("net_pd", "net_pd.elf", priority=96, budget=20000, stack_size=0x20000)
+    else:
+        net_client_name = "debugger"
+        net_client = debugger
+
+    net_copier = ProtectionDomain(
+        f"{net_client_name}_net_copier", "network_copy.elf", priority=98, budget=20000
     )
 
-    serial_system.add_client(debugger)
-    timer_system.add_client(debugger)
-    net_system.add_client_with_copier(debugger, debugger_net_copier)
+    serial_system.add_client(net_client)
+    timer_system.add_client(net_client)
+    net_system.add_client_with_copier(net_client, net_copier)
 
-    debugger_lib_sddf_lwip = Sddf.Lwip(sdf, net_system, debugger)
+    lib_sddf_lwip = Sddf.Lwip(sdf, net_system, net_client)
 
     ping = ProtectionDomain("ping", "ping.elf", priority=1)
     pong = ProtectionDomain("pong", "pong.elf", priority=1)
@@ -134,10 +150,13 @@ def generate(sdf_file: str, output_dir: str, dtb: DeviceTree):
         ethernet_driver,
         net_virt_tx,
         net_virt_rx,
-        debugger_net_copier,
+        net_copier,
         timer_driver,
     ]
 
+    if split:
+        pds.append(net_client)
+
     for pd in debug_pds:
         child_id = debugger.add_child_pd(pd)
 
@@ -147,14 +166,27 @@ def generate(sdf_file: str, output_dir: str, dtb: DeviceTree):
     ping_pong_channel = Channel(ping, pong)
     sdf.add_channel(ping_pong_channel)
 
+    if split:
+        rings = {
+            "to_debugger_ring": 0x30_000_000,
+            "to_gdb_ring": 0x30_000_000 + RSP_RING_REGION_SIZE,
+        }
+        for ring, vaddr in rings.items():
+            mr = MemoryRegion(sdf, ring, RSP_RING_REGION_SIZE)
+            sdf.add_mr(mr)
+            for pd in [debugger, net_client]:
+                pd.add_map(Map(mr, vaddr, "rw", setvar_vaddr=f"{ring}_vaddr"))
+
+        sdf.add_channel(Channel(debugger, net_client, a_id=RSP_NET_PD_CH, b_id=RSP_DEBUGGER_CH))
+
     assert serial_system.connect()
     assert serial_system.serialise_config(output_dir)
     assert net_system.connect()
     assert net_system.serialise_config(output_dir)
     assert timer_system.connect()
     assert timer_system.serialise_config(output_dir)
-    assert debugger_lib_sddf_lwip.connect()
-    assert debugger_lib_sddf_lwip.serialise_config(output_dir)
+    assert lib_sddf_lwip.connect()
+    assert lib_sddf_lwip.serialise_config(output_dir)
 
     with open(f"{output_dir}/{sdf_file}", "w+") as f:
         f.write(sdf.render())
@@ -167,6 +199,8 @@ if __name__ == '__main__':
     parser.add_argument("--board", required=True, choices=[b.name for b in BOARDS])
     parser.add_argument("--output", required=True)
     parser.add_argument("--sdf", required=True)
+    parser.add_argument("--split", action="store_true",
+                        help="run lwIP in a separate network PD rather than in the debugger")
 
     args = parser.parse_args()
 
@@ -178,4 +212,4 @@ if __name__ == '__main__':
     with open(args.dtb, "rb") as f:
         dtb = DeviceTree(f.read())
 
-    generate(args.sdf, args.output, dtb)
+    generate(args.sdf, args.output, dtb, args.split)
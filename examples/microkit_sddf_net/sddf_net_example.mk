@@ -36,6 +36,23 @@ IMAGES := eth_driver.elf debugger.elf network_virt_rx.elf \
 	  network_virt_tx.elf network_copy.elf timer_driver.elf \
 	  serial_driver.elf serial_virt_tx.elf ping.elf pong.elf
 
+# In the split configuration, the network PD runs lwIP and is the sDDF client, and passes the RSP
+# byte stream to the debugger PD through shared rings. Otherwise the debugger does everything.
+ifeq ($(SPLIT_NET),1)
+    IMAGES += net_pd.elf
+    NET_CLIENT := net_pd
+    META_FLAGS := --split
+    DEBUGGER_OBJS := debugger_split.o
+    NET_PD_OBJS := net_pd.o net_stack.o tcp.o
+    # The rings only carry a single connection
+    NUM_SESSIONS := 1
+else
+    NET_CLIENT := debugger
+    META_FLAGS :=
+    DEBUGGER_OBJS := debugger.o net_stack.o tcp.o
+    NET_PD_OBJS :=
+endif
+
 CFLAGS := -mcpu=$(CPU) \
 	  -mstrict-align \
 	  -ffreestanding \
@@ -43,6 +60,7 @@ CFLAGS := -mcpu=$(CPU) \
 	  -Wno-unused-function \
 	  -DMICROKIT_CONFIG_$(MICROKIT_CONFIG) \
 	  -DMICROKIT \
+	  -DNUM_SESSIONS=$(NUM_SESSIONS) \
 	  -nostdlib \
 	  -I$(BOARD_DIR)/include \
 	  -I$(SDDF)/include \
@@ -50,7 +68,6 @@ CFLAGS := -mcpu=$(CPU) \
 	  -I${DEBUGGER_INCLUDE}/lwip \
 	  -I${SDDF}/$(LWIPDIR)/include \
 	  -I${SDDF}/$(LWIPDIR)/include/ipv4 \
-	  -I$(SDDF)/libco \
 	  -I$(LIBGDB_DIR)/include \
 	  -I$(LIBGDB_DIR)/arch_include \
 	  -MD \
@@ -74,21 +91,31 @@ debugger.o: $(TOP)/apps/debugger/debugger.c
 tcp.o: $(TOP)/apps/debugger/tcp.c
 	$(CC) -c $(CFLAGS) $(TOP)/apps/debugger/tcp.c -o $@
 
+net_stack.o: $(TOP)/apps/debugger/net_stack.c
+	$(CC) -c $(CFLAGS) $(TOP)/apps/debugger/net_stack.c -o $@
+
+debugger_split.o: $(TOP)/apps/debugger/debugger_split.c
+	$(CC) -c $(CFLAGS) $(TOP)/apps/debugger/debugger_split.c -o $@
+
+net_pd.o: $(TOP)/apps/debugger/net_pd.c
+	$(CC) -c $(CFLAGS) $(TOP)/apps/debugger/net_pd.c -o $@
+
 ping.o: $(TOP)/apps/ping.c
 	$(CC) -c $(CFLAGS) $(TOP)/apps/ping.c -o $@
 
 pong.o: $(TOP)/apps/pong.c
 	$(CC) -c $(CFLAGS) $(TOP)/apps/pong.c -o $@
 
-DEBUGGER_OBJS := debugger.o tcp.o
-
-DEPS := $(DEBUGGER_OBJS:.o=.d)
+DEPS := $(DEBUGGER_OBJS:.o=.d) $(NET_PD_OBJS:.o=.d)
 
 all: loader.img
 
-${DEBUGGER_OBJS}: ${CHECK_FLAGS_BOARD_MD5}
-debugger.elf: $(DEBUGGER_OBJS) libsddf_util.a lib_sddf_lwip.a libgdb.a libco.a
-	$(LD) $(LDFLAGS) $(DEBUGGER_OBJS) libsddf_util.a lib_sddf_lwip.a libgdb.a libco.a $(LIBS) -o $@
+${DEBUGGER_OBJS} ${NET_PD_OBJS}: ${CHECK_FLAGS_BOARD_MD5}
+debugger.elf: $(DEBUGGER_OBJS) libsddf_util.a lib_sddf_lwip.a libgdb.a
+	$(LD) $(LDFLAGS) $(DEBUGGER_OBJS) libsddf_util.a lib_sddf_lwip.a libgdb.a $(LIBS) -o $@
+
+net_pd.elf: $(NET_PD_OBJS) libsddf_util.a lib_sddf_lwip.a
+	$(LD) $(LDFLAGS) $(NET_PD_OBJS) libsddf_util.a lib_sddf_lwip.a $(LIBS) -o $@
 
 # Need to build libsddf_util_debug.a because it's included in LIBS
 # for the unimplemented libc dependencies
@@ -98,7 +125,7 @@ $(DTB): $(DTS)
 	dtc -q -I dts -O dtb $(DTS) > $(DTB)
 
 $(SYSTEM_FILE): $(METAPROGRAM) $(IMAGES) $(DTB)
-	$(PYTHON) $(METAPROGRAM) --sddf $(SDDF) --board $(MICROKIT_BOARD) --dtb $(DTB) --output . --sdf $(SYSTEM_FILE)
+	$(PYTHON) $(METAPROGRAM) --sddf $(SDDF) --board $(MICROKIT_BOARD) --dtb $(DTB) --output . --sdf $(SYSTEM_FILE) $(META_FLAGS)
 	$(OBJCOPY) --update-section .device_resources=serial_driver_device_resources.data serial_driver.elf
 	$(OBJCOPY) --update-section .serial_driver_config=serial_driver_config.data serial_driver.elf
 	$(OBJCOPY) --update-section .serial_virt_tx_config=serial_virt_tx.data serial_virt_tx.elf
@@ -106,12 +133,12 @@ $(SYSTEM_FILE): $(METAPROGRAM) $(IMAGES) $(DTB)
 	$(OBJCOPY) --update-section .net_driver_config=net_driver.data eth_driver.elf
 	$(OBJCOPY) --update-section .net_virt_rx_config=net_virt_rx.data network_virt_rx.elf
 	$(OBJCOPY) --update-section .net_virt_tx_config=net_virt_tx.data network_virt_tx.elf
-	$(OBJCOPY) --update-section .net_copy_config=net_copy_debugger_net_copier.data network_copy.elf
+	$(OBJCOPY) --update-section .net_copy_config=net_copy_$(NET_CLIENT)_net_copier.data network_copy.elf
 	$(OBJCOPY) --update-section .device_resources=timer_driver_device_resources.data timer_driver.elf
-	$(OBJCOPY) --update-section .timer_client_config=timer_client_debugger.data debugger.elf
-	$(OBJCOPY) --update-section .net_client_config=net_client_debugger.data debugger.elf
-	$(OBJCOPY) --update-section .serial_client_config=serial_client_debugger.data debugger.elf
-	$(OBJCOPY) --update-section .lib_sddf_lwip_config=lib_sddf_lwip_config_debugger.data debugger.elf
+	$(OBJCOPY) --update-section .timer_client_config=timer_client_$(NET_CLIENT).data $(NET_CLIENT).elf
+	$(OBJCOPY) --update-section .net_client_config=net_client_$(NET_CLIENT).data $(NET_CLIENT).elf
+	$(OBJCOPY) --update-section .serial_client_config=serial_client_$(NET_CLIENT).data $(NET_CLIENT).elf
+	$(OBJCOPY) --update-section .lib_sddf_lwip_config=lib_sddf_lwip_config_$(NET_CLIENT).data $(NET_CLIENT).elf
 
 ${IMAGE_FILE} $(REPORT_FILE): $(IMAGES) $(SYSTEM_FILE)
 	$(MICROKIT_TOOL) $(SYSTEM_FILE) --search-path $(BUILD_DIR) --board $(MICROKIT_BOARD) --config $(MICROKIT_CONFIG) -o $(IMAGE_FILE) -r $(REPORT_FILE)
@@ -126,7 +153,10 @@ include ${TIMER_DRIVER}/timer_driver.mk
 include ${SERIAL_DRIVER}/serial_driver.mk
 include ${SERIAL_COMPONENTS}/serial_components.mk
 include $(LIBGDB_DIR)/libgdb.mk
-include ${SDDF}/libco/libco.mk
+
+comma := ,
+GDB_PORTS := $(shell seq 1234 $$((1233 + $(NUM_SESSIONS))))
+HOSTFWD := $(subst $(eval) ,,$(foreach port,$(GDB_PORTS),$(comma)hostfwd=tcp::$(port)-:$(port)))
 
 qemu: $(IMAGE_FILE)
 	$(QEMU) -machine virt,virtualization=on \
@@ -136,7 +166,7 @@ qemu: $(IMAGE_FILE)
 			-m size=2G \
 			-nographic \
 			-device virtio-net-device,netdev=netdev0 \
-			-netdev user,id=netdev0,hostfwd=tcp::1234-:1234 \
+			-netdev user,id=netdev0$(HOSTFWD) \
 			-global virtio-mmio.force-legacy=false \
 			-d guest_errors
 
@@ -7,198 +7,125 @@
 #include <microkit.h>
 #include <sel4/sel4_arch/types.h>
 #include <gdb.h>
+#include <transport.h>
 #include <util.h>
-#include <libco.h>
 #include <stddef.h>
+#include <string.h>
 #include <sddf/serial/config.h>
 #include <sddf/serial/queue.h>
+#include <sddf/util/util.h>
 #include <sddf/util/printf.h>
 #include <sddf/serial/config.h>
 
 __attribute__((__section__(".serial_client_config"))) serial_client_config_t config;
 
-typedef enum event_state {
-    eventState_none = 0,
-    eventState_waitingForInputEventLoop,
-    eventState_waitingForInputFault
-} event_state_t;
-
-cothread_t t_event, t_main, t_fault;
-
 #define NUM_DEBUGEES 2
 
-#define STACK_SIZE 4096
-static char t_main_stack[STACK_SIZE];
-static char t_fault_stack[STACK_SIZE];
-
-/* Input buffer */
-static char input[BUFSIZE];
+/* libgdb's state, and that of the transport layer on top of it */
+static gdb_ctx_t ctx;
+static gdb_transport_ctx_t tctx;
 
-/* Output buffer */
+/* Output buffer for registering the initial threads */
 static char output[BUFSIZE];
 
-serial_queue_t *rx_queue;
-serial_queue_t *tx_queue;
-
-char *rx_data;
-char *tx_data;
-
 serial_queue_handle_t rx_queue_handle;
 serial_queue_handle_t tx_queue_handle;
 
-/* The current event state and phase */
-event_state_t state = eventState_none;
-static bool detached = false;
+/* Whether characters have been put in the tx queue without notifying the virtualiser yet */
+static bool tx_pending = false;
 
+/* Output that didn't fit in the tx queue, which is sent once the virtualiser has made space for it.
+   The transport never has more than an unacked packet, a notification and a few acks waiting to go
+   out, so this cannot fill up. */
+#define TX_BACKLOG_SIZE (4 * BUFSIZE)
+static char tx_backlog[TX_BACKLOG_SIZE];
+static uint32_t tx_backlog_len = 0;
 
 void _putchar(char character) {
     microkit_dbg_putc(character);
 }
 
-/* @alwin: surely there is a less disgusting way of doing this */
-void gdb_put_char(char c) {
-    sddf_putchar_unbuffered(c);
-}
-
-char gdb_get_char(event_state_t new_state) {
-    while (serial_queue_empty(&rx_queue_handle, rx_queue_handle.queue->head)) {
-        // Wait for the virt to tell us some input has come through
-        state = new_state;
-        co_switch(t_event);
+/* Packets are framed straight out of the rx queue's data region */
+static char *serial_recv_peek(void *cookie, uint32_t *len) {
+    uint32_t length = serial_queue_length(&rx_queue_handle);
+    if (length == 0) {
+        return NULL;
     }
 
-    char c;
-    serial_dequeue(&rx_queue_handle, &c);
-
-    return c;
+    uint32_t offset = rx_queue_handle.queue->head % rx_queue_handle.capacity;
+    *len = MIN(length, rx_queue_handle.capacity - offset);
+    return rx_queue_handle.data_region + offset;
 }
 
-char *get_packet(event_state_t new_state) {
-    char c;
-    int count;
-    /* Checksum and expected checksum */
-    unsigned char cksum, xcksum;
-    char *buf = input;
-    (void) buf;
-
-    while (1) {
-        /* Wait for the start character - ignoring all other characters */
-        c = gdb_get_char(new_state);
-        while (c != '$') {
-            /* Ctrl-C character - should result in an interrupt */
-            if (c == 3) {
-                buf[0] = c;
-                buf[1] = 0;
-                return buf;
-            }
-            c = gdb_get_char(new_state);
-        }
-        retry:
-        /* Initialize cksum variables */
-        cksum = 0;
-        xcksum = -1;
-        count = 0;
-
-        /* Read until we see a # or the buffer is full */
-        while (count < BUFSIZE - 1) {
-            c = gdb_get_char(new_state);
-            if (c == '$') {
-                goto retry;
-            } else if (c == '#') {
-                break;
-            }
-            cksum += c;
-            buf[count++] = c;
-        }
-
-        /* Null terminate the string */
-        buf[count] = 0;
-
-        if (c == '#') {
-            c = gdb_get_char(new_state);
-            xcksum = hexchar_to_int(c) << 4;
-            c = gdb_get_char(new_state);
-            xcksum += hexchar_to_int(c);
-
-            if (cksum != xcksum) {
-                gdb_put_char('-');   /* checksum failed */
-            } else {
-                gdb_put_char('+');   /* checksum success, ack*/
-
-                if (buf[2] == ':') {
-                    gdb_put_char(buf[0]);
-                    gdb_put_char(buf[1]);
+static void serial_recv_consume(void *cookie, uint32_t len) {
+    serial_update_shared_head(&rx_queue_handle, rx_queue_handle.queue->head + len);
+}
 
-                    return &buf[3];
-                }
+/* Put as much of buf in the tx queue as fits, returning how much that was */
+static uint32_t tx_enqueue(const char *buf, uint32_t len) {
+    uint32_t free = tx_queue_handle.capacity - serial_queue_length(&tx_queue_handle);
+    uint32_t n = MIN(len, free);
+    if (n != 0) {
+        serial_enqueue_batch(&tx_queue_handle, n, buf);
+        tx_pending = true;
+    }
+    return n;
+}
 
-                return buf;
-            }
-        }
+/* Output to GDB is put in the tx queue in bulk and the virtualiser is only notified once it has all
+   been queued, rather than once per character. Whatever doesn't fit is kept in order in the backlog
+   and sent from notified() when the virtualiser has consumed some of the queue, so packets are never
+   cut short and nothing here waits on the virtualiser. */
+static void serial_send(void *cookie, const char *buf, uint32_t len) {
+    uint32_t sent = (tx_backlog_len == 0) ? tx_enqueue(buf, len) : 0;
+    if (sent == len) {
+        return;
     }
 
-    return NULL;
+    assert(len - sent <= TX_BACKLOG_SIZE - tx_backlog_len);
+    memcpy(tx_backlog + tx_backlog_len, buf + sent, len - sent);
+    tx_backlog_len += len - sent;
+    serial_request_consumer_signal(&tx_queue_handle);
 }
 
-/*
- * Send a packet, computing it's checksum, waiting for it's acknoledge.
- * If there is not ack, packet will be resent.
- */
-static void put_packet(char *buf, event_state_t new_state)
-{
-    uint8_t cksum;
-    for (;;) {
-        gdb_put_char('$');
-        char *buf2 = buf;
-        for (cksum = 0; *buf2; buf2++) {
-            cksum += *buf2;
-            gdb_put_char(*buf2);
-        }
-        gdb_put_char('#');
-        gdb_put_char(int_to_hexchar(cksum >> 4));
-        gdb_put_char(int_to_hexchar(cksum % 16));
-        char c = gdb_get_char(new_state);
-        if (c == '+') break;
+static void send_backlog(void) {
+    uint32_t sent = tx_enqueue(tx_backlog, tx_backlog_len);
+    memmove(tx_backlog, tx_backlog + sent, tx_backlog_len - sent);
+    tx_backlog_len -= sent;
+    if (tx_backlog_len != 0) {
+        serial_request_consumer_signal(&tx_queue_handle);
     }
 }
 
-static void event_loop();
-static void init_phase2();
-
-static void event_loop() {
-    bool resume = false;
-    /* The event loop runs perpetually if we are in the standard event loop phase */
-    while (true) {
-        char *input = get_packet(eventState_waitingForInputEventLoop);
-        if (detached || input[0] == 3) {
-            /* If we got a ctrl-c packet, we should suspend the whole system */
-            suspend_system();
-            detached = false;
-        }
-
-        resume = gdb_handle_packet(input, output, &detached);
-
-        if (!resume || detached) {
-            put_packet(output, eventState_waitingForInputEventLoop);
-        }
-
-        if (resume) {
-            resume_system();
-        }
+static void serial_flush(void *cookie) {
+    if (tx_pending) {
+        tx_pending = false;
+        microkit_notify(config.tx.id);
     }
 }
 
+static gdb_transport_t serial_transport = {
+    .cookie = NULL,
+    .recv_peek = serial_recv_peek,
+    .recv_consume = serial_recv_consume,
+    .send = serial_send,
+    .flush = serial_flush,
+};
+
 void init() {
     assert(serial_config_check_magic(&config));
 
+    gdb_ctx_init(&ctx);
+    gdb_transport_ctx_init(&tctx, &ctx);
+
     /* Register all of the inferiors  */
     for (int i = 0; i < NUM_DEBUGEES; i++) {
-        gdb_register_inferior(i, BASE_VSPACE_CAP + i);
-        gdb_register_thread(i, 0, BASE_TCB_CAP + i, output);
+        gdb_register_inferior(&ctx, i, BASE_VSPACE_CAP + i);
+        gdb_register_thread(&ctx, i, 0, BASE_TCB_CAP + i, output);
     }
 
     /* First, we suspend all the debugeee PDs*/
-    suspend_system();
+    suspend_system(&ctx);
 
     /* Set up sDDF ring buffers */
     serial_queue_init(&rx_queue_handle, config.rx.queue.vaddr, config.rx.data.size, config.rx.data.vaddr);
@@ -208,38 +135,18 @@ void init() {
 
     microkit_dbg_puts("Awaiting GDB connection...");
 
-    /* Make a coroutine for the rest of the initialization */
-    t_event = co_active();
-    t_main = co_derive((void *) t_main_stack, STACK_SIZE, event_loop);
-
-    co_switch(t_main);
-}
-
-
-void fault_message() {
-    put_packet(output, eventState_waitingForInputFault);
-    // Go back to waiting for normal input after we send the fault packet to the host
-    state = eventState_waitingForInputEventLoop;
-    co_switch(t_event);
+    /* The serial line is always connected, so GDB can start talking to us at any point */
+    gdb_transport_init(&tctx, 0, &serial_transport);
 }
 
 seL4_Bool fault(microkit_child ch, microkit_msginfo msginfo, microkit_msginfo *reply_msginfo) {
-    seL4_Word reply_mr = 0;
-
-    suspend_system();
-
     // @alwin: I'm not entirely convinced there is a point having reply_mr here still
     bool have_reply;
-    DebuggerError err = gdb_handle_fault(ch, 0, microkit_msginfo_get_label(msginfo), &reply_mr, output, &have_reply);
+    DebuggerError err = gdb_transport_fault(&tctx, ch, 0, microkit_msginfo_get_label(msginfo), &have_reply);
     if (err) {
         microkit_dbg_puts("GDB: Internal assertion failed. Could not find faulting thread");
     }
 
-    // Start a coroutine for dealing with the fault and transmitting a message to the host
-    t_event = co_active();
-    t_fault = co_derive((void *) t_fault_stack, STACK_SIZE, fault_message);
-    co_switch(t_fault);
-
     if (have_reply) {
         *reply_msginfo = microkit_msginfo_new(0, 0);
         return true;
@@ -249,16 +156,10 @@ seL4_Bool fault(microkit_child ch, microkit_msginfo msginfo, microkit_msginfo *r
 }
 
 void notified(microkit_channel ch) {
-    if (state == eventState_waitingForInputFault) {
-        state = eventState_none;
-        co_switch(t_fault);
-    }
-
-
-    /* This is not an else if because we want to switch to the event loop after
-       handling the fault message. We could probably do this unconditionally?  */
-    if (state == eventState_waitingForInputEventLoop) {
-        state = eventState_none;
-        co_switch(t_main);
+    if (ch == config.rx.id) {
+        gdb_transport_poll(&tctx, 0);
+    } else if (ch == config.tx.id && tx_backlog_len != 0) {
+        send_backlog();
+        serial_flush(NULL);
     }
 }
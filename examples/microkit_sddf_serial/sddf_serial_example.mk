@@ -40,7 +40,6 @@ CFLAGS := -mcpu=$(CPU) \
 	  -I$(BOARD_DIR)/include \
 	  -I$(SDDF)/include \
 	  -I$(SDDF)/include/microkit \
-	  -I$(SDDF)/libco \
 	  -I$(LIBGDB_DIR)/include \
 	  -I$(LIBGDB_DIR)/arch_include \
 	  -MD \
@@ -75,8 +74,8 @@ DEPS := $(DEBUGGER_OBJS:.o=.d)
 all: loader.img
 
 ${DEBUGGER_OBJS}: ${CHECK_FLAGS_BOARD_MD5}
-debugger.elf: $(DEBUGGER_OBJS) libsddf_util.a libgdb.a libco.a
-	$(LD) $(LDFLAGS) $(DEBUGGER_OBJS) libsddf_util.a libgdb.a libco.a $(LIBS) -o $@
+debugger.elf: $(DEBUGGER_OBJS) libsddf_util.a libgdb.a
+	$(LD) $(LDFLAGS) $(DEBUGGER_OBJS) libsddf_util.a libgdb.a $(LIBS) -o $@
 
 # Need to build libsddf_util_debug.a because it's included in LIBS
 # for the unimplemented libc dependencies
@@ -100,7 +99,6 @@ include ${SDDF}/util/util.mk
 include ${SERIAL_DRIVER}/serial_driver.mk
 include ${SERIAL_COMPONENTS}/serial_components.mk
 include $(LIBGDB_DIR)/libgdb.mk
-include ${SDDF}/libco/libco.mk
 
 qemu: $(IMAGE_FILE)
 	$(QEMU) -machine virt,virtualization=on \
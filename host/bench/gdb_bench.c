@@ -0,0 +1,465 @@
+/*
+ * Copyright 2025, UNSW
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+/*
+ * Microbenchmarks for libgdb's protocol handling, run against the simulated kernel. Each benchmark
+ * reports the time, protocol bytes and system calls per operation, for every size and thread count
+ * it depends on.
+ *
+ * usage: gdb_bench [-s sizes] [-t thread_counts] [-m min_ms] [-c] [filter]
+ */
+
+#include <gdb.h>
+#include <framer.h>
+#include <transport.h>
+#include <util.h>
+#include <sel4_sim.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MAX_ARGS 16
+#define INFERIOR_ID 1
+/* What GDB knows the inferior and its first thread as */
+#define GDB_PID 1
+#define GDB_TID 1
+#define MEM_BASE 0x400000
+#define MEM_SIZE 0x10000
+
+typedef struct bench {
+    const char *name;
+    /* What the results depend on, and so which of the sizes and thread counts are run */
+    bool sized;
+    bool threaded;
+    /* Get ready to run with the given size. Returns the protocol bytes handled per operation, or -1
+       if the size doesn't apply (e.g. it doesn't fit in a packet). */
+    int (*setup)(int size);
+    void (*run)(void);
+} bench_t;
+
+static gdb_ctx_t ctx;
+static gdb_transport_ctx_t tctx;
+static unsigned char inferior_mem[MEM_SIZE];
+
+static char input[BUFSIZE];
+static char output[BUFSIZE];
+static char scratch[BUFSIZE];
+static seL4_UserContext regs;
+/* Size of the conversion benchmarks */
+static int convert_size;
+
+/* Next packet to be run through a packet benchmark, and the one that undoes it (if any) */
+static char packet[BUFSIZE];
+static char undo_packet[BUFSIZE];
+
+static gdb_framer_t framer;
+static char frame[BUFSIZE + 8];
+static int frame_len;
+
+/* An in-memory transport that GDB's side of the connection is fed into */
+static char rx_buf[BUFSIZE + 8];
+static uint32_t rx_len, rx_pos;
+static uint64_t tx_bytes;
+
+static char *mem_recv_peek(void *cookie, uint32_t *len) {
+    if (rx_pos == rx_len) {
+        return NULL;
+    }
+
+    *len = rx_len - rx_pos;
+    return rx_buf + rx_pos;
+}
+
+static void mem_recv_consume(void *cookie, uint32_t len) {
+    rx_pos += len;
+}
+
+static void mem_send(void *cookie, const char *buf, uint32_t len) {
+    tx_bytes += len;
+}
+
+static void mem_flush(void *cookie) {
+}
+
+static gdb_transport_t mem_transport = {
+    .recv_peek = mem_recv_peek,
+    .recv_consume = mem_recv_consume,
+    .send = mem_send,
+    .flush = mem_flush,
+};
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void fail(const char *what, const char *got) {
+    fprintf(stderr, "gdb_bench: %s failed (got \"%.64s\")\n", what, got);
+    exit(1);
+}
+
+/* Frame a payload the way GDB does, returning the length of the frame */
+static int frame_packet(char *dst, const char *payload) {
+    uint8_t cksum = 0;
+    int len = 0;
+    dst[len++] = '$';
+    for (const char *p = payload; *p; p++) {
+        cksum += *p;
+        dst[len++] = *p;
+    }
+    dst[len++] = '#';
+    dst[len++] = int_to_hexchar(cksum >> 4);
+    dst[len++] = int_to_hexchar(cksum % 16);
+    return len;
+}
+
+/* A fresh system with one inferior of num_threads threads, stopped and with GDB connected */
+static void setup_system(int num_threads) {
+    sim_reset();
+    gdb_ctx_init(&ctx);
+    gdb_transport_ctx_init(&tctx, &ctx);
+
+    seL4_CPtr vspace = sim_vspace_create();
+    if (!sim_vspace_map(vspace, MEM_BASE, inferior_mem, MEM_SIZE) ||
+        gdb_register_inferior(&ctx, INFERIOR_ID, vspace) != DebuggerError_NoError) {
+        fail("registering the inferior", "");
+    }
+
+    for (int i = 0; i < num_threads; i++) {
+        seL4_CPtr tcb = sim_tcb_create();
+        if (tcb == 0 || gdb_register_thread(&ctx, INFERIOR_ID, i, tcb, output) != DebuggerError_NoError) {
+            fail("registering a thread", "");
+        }
+
+        sim_tcb_t *t = sim_tcb(tcb);
+        seL4_Word *words = (seL4_Word *) &t->regs;
+        for (int j = 0; j < sizeof(seL4_UserContext) / sizeof(seL4_Word); j++) {
+            words[j] = 0x0123456789abcdef * (j + 1);
+        }
+        t->regs.pc = MEM_BASE;
+        t->regs.sp = MEM_BASE + MEM_SIZE;
+    }
+
+    for (int i = 0; i < MEM_SIZE; i++) {
+        inferior_mem[i] = i * 7;
+    }
+
+    suspend_system(&ctx);
+    gdb_transport_init(&tctx, 0, &mem_transport);
+}
+
+/* Run a packet through gdb_handle_packet once, and make sure it did what it should */
+static int check_packet(const char *pkt, const char *expected) {
+    bool detached;
+    strlcpy(input, pkt, BUFSIZE);
+    gdb_handle_packet(&ctx, input, output, &detached);
+    if (expected != NULL && strncmp(output, expected, strlen(expected)) != 0) {
+        fail(pkt, output);
+    }
+    return strlen(pkt) + strlen(output);
+}
+
+static void run_packet(void) {
+    bool detached;
+    gdb_handle_packet(&ctx, packet, output, &detached);
+    if (undo_packet[0] != 0) {
+        gdb_handle_packet(&ctx, undo_packet, output, &detached);
+    }
+}
+
+/* mem2hex and hex2mem */
+
+static int setup_convert(int size) {
+    if (size * 2 >= BUFSIZE) {
+        return -1;
+    }
+
+    mem2hex((char *) inferior_mem, scratch, size);
+    convert_size = size;
+    return size;
+}
+
+static void run_mem2hex(void) {
+    mem2hex((char *) inferior_mem, scratch, convert_size);
+}
+
+static void run_hex2mem(void) {
+    hex2mem(scratch, (char *) inferior_mem, convert_size);
+}
+
+/* regs2hex and hex2regs */
+
+static int setup_regs(int size) {
+    seL4_Word *words = (seL4_Word *) &regs;
+    for (int i = 0; i < sizeof(seL4_UserContext) / sizeof(seL4_Word); i++) {
+        words[i] = 0xfedcba9876543210 - i;
+    }
+    regs2hex(&regs, scratch);
+    return sizeof(seL4_UserContext);
+}
+
+static void run_regs2hex(void) {
+    regs2hex(&regs, scratch);
+}
+
+static void run_hex2regs(void) {
+    hex2regs(&regs, scratch);
+}
+
+/*
+ * parse_thread_id and parse_mem_format are private to gdb.c, so they are measured through the
+ * cheapest packets that use them: T (is the thread alive) and a zero length m.
+ */
+
+static int setup_thread_id(int size) {
+    snprintf(packet, BUFSIZE, "Tp%x.%x", GDB_PID, GDB_TID);
+    undo_packet[0] = 0;
+    return check_packet(packet, "OK");
+}
+
+static int setup_mem_format(int size) {
+    snprintf(packet, BUFSIZE, "m%x,0", MEM_BASE);
+    undo_packet[0] = 0;
+    return check_packet(packet, NULL);
+}
+
+/* g, m, M, Z and vCont */
+
+static int setup_g(int size) {
+    strlcpy(packet, "g", BUFSIZE);
+    undo_packet[0] = 0;
+    return check_packet(packet, NULL);
+}
+
+static int setup_m(int size) {
+    if (size * 2 >= BUFSIZE || size > MEM_SIZE) {
+        return -1;
+    }
+
+    snprintf(packet, BUFSIZE, "m%x,%x", MEM_BASE, size);
+    undo_packet[0] = 0;
+    return check_packet(packet, NULL);
+}
+
+static int setup_M(int size) {
+    int len = snprintf(packet, BUFSIZE, "M%x,%x:", MEM_BASE, size);
+    if (len + size * 2 >= BUFSIZE || size > MEM_SIZE) {
+        return -1;
+    }
+
+    mem2hex((char *) inferior_mem, packet + len, size);
+    undo_packet[0] = 0;
+    return check_packet(packet, "OK");
+}
+
+/* Inserting a breakpoint and removing it again */
+static int setup_Z(int size) {
+    snprintf(packet, BUFSIZE, "Z0,%x,4", MEM_BASE + 0x100);
+    snprintf(undo_packet, BUFSIZE, "z0,%x,4", MEM_BASE + 0x100);
+    return check_packet(packet, "OK") + check_packet(undo_packet, "OK");
+}
+
+/* A whole single step: GDB steps one thread and continues the rest, and the step comes back as a
+   debug exception */
+static void run_step(void) {
+    bool detached, have_reply;
+    seL4_Word reply_mr;
+
+    if (gdb_handle_packet(&ctx, packet, output, &detached)) {
+        resume_system(&ctx);
+    }
+
+    sim_debug_exception(MEM_BASE + 4, seL4_SingleStep, 0, 0);
+    gdb_handle_fault(&ctx, INFERIOR_ID, 0, seL4_Fault_DebugException, &reply_mr, output, &have_reply);
+    if (output[0] != 0) {
+        suspend_system(&ctx);
+    }
+}
+
+static int setup_step(int size) {
+    snprintf(packet, BUFSIZE, "vCont;s:p%x.%x;c", GDB_PID, GDB_TID);
+    run_step();
+    if (output[0] != 'T') {
+        fail(packet, output);
+    }
+    return strlen(packet) + strlen(output);
+}
+
+/* Framing and checksums */
+
+static int setup_framer(int size) {
+    if (size * 2 >= BUFSIZE) {
+        return -1;
+    }
+
+    /* The payload of an M packet is what large packets from GDB look like */
+    mem2hex((char *) inferior_mem, scratch, size);
+    frame_len = frame_packet(frame, scratch);
+    gdb_framer_init(&framer);
+    return frame_len;
+}
+
+static void run_framer(void) {
+    frame_event_t event;
+    if (gdb_framer_feed(&framer, frame, frame_len, &event) != frame_len || event != frameEvent_packet) {
+        fail("framing", framer.buf);
+    }
+}
+
+/* A memory read all the way through the transport: framing the request, handling it, and framing
+   the reply with its checksum */
+static int setup_transport(int size) {
+    if (size * 2 >= BUFSIZE || size > MEM_SIZE) {
+        return -1;
+    }
+
+    /* Each request acks the reply to the one before it */
+    rx_buf[0] = '+';
+    snprintf(scratch, BUFSIZE, "m%x,%x", MEM_BASE, size);
+    rx_len = 1 + frame_packet(rx_buf + 1, scratch);
+
+    tx_bytes = 0;
+    rx_pos = 0;
+    gdb_transport_poll(&tctx, 0);
+    return rx_len + tx_bytes;
+}
+
+static void run_transport(void) {
+    rx_pos = 0;
+    gdb_transport_poll(&tctx, 0);
+}
+
+static bench_t benches[] = {
+    { "mem2hex", true, false, setup_convert, run_mem2hex },
+    { "hex2mem", true, false, setup_convert, run_hex2mem },
+    { "regs2hex", false, false, setup_regs, run_regs2hex },
+    { "hex2regs", false, false, setup_regs, run_hex2regs },
+    { "parse_thread_id (T)", false, true, setup_thread_id, run_packet },
+    { "parse_mem_format (m,0)", false, false, setup_mem_format, run_packet },
+    { "packet g", false, false, setup_g, run_packet },
+    { "packet m", true, false, setup_m, run_packet },
+    { "packet M", true, false, setup_M, run_packet },
+    { "packet Z0+z0", false, true, setup_Z, run_packet },
+    { "packet vCont step", false, true, setup_step, run_step },
+    { "framer", true, false, setup_framer, run_framer },
+    { "transport m", true, false, setup_transport, run_transport },
+};
+
+static uint64_t min_ns = 200 * 1000000ull;
+static bool csv = false;
+
+/* Run a benchmark for at least min_ns, doubling the number of iterations until it has */
+static void measure(bench_t *b, int size, int threads) {
+    setup_system(threads);
+    int bytes = b->setup(size);
+    if (bytes < 0) {
+        return;
+    }
+
+    uint64_t iters, elapsed, syscalls;
+    for (iters = 1;; iters *= 2) {
+        syscalls = sim_syscall_total();
+        uint64_t start = now_ns();
+        for (uint64_t i = 0; i < iters; i++) {
+            b->run();
+        }
+        elapsed = now_ns() - start;
+        syscalls = sim_syscall_total() - syscalls;
+        if (elapsed >= min_ns) {
+            break;
+        }
+    }
+
+    double ns_per_op = (double) elapsed / iters;
+    double mb_per_s = bytes * 1000.0 / ns_per_op;
+    double syscalls_per_op = (double) syscalls / iters;
+    if (csv) {
+        printf("%s,%d,%d,%.2f,%d,%.2f,%.2f\n", b->name, size, threads, ns_per_op, bytes, mb_per_s, syscalls_per_op);
+    } else {
+        printf("%-24s %6d %7d %12.1f %8d %10.1f %12.2f\n", b->name, size, threads, ns_per_op, bytes, mb_per_s,
+               syscalls_per_op);
+    }
+}
+
+/* Parse a comma separated list of positive numbers */
+static int parse_list(char *str, int *list, int max) {
+    int n = 0;
+    for (char *tok = strtok(str, ","); tok != NULL; tok = strtok(NULL, ",")) {
+        int value = atoi(tok);
+        if (value <= 0 || n == max) {
+            return -1;
+        }
+        list[n++] = value;
+    }
+    return n;
+}
+
+static void usage(void) {
+    fprintf(stderr, "usage: gdb_bench [-s sizes] [-t thread_counts] [-m min_ms] [-c] [filter]\n");
+    exit(1);
+}
+
+int main(int argc, char **argv) {
+    int sizes[MAX_ARGS] = { 8, 64, 256, 1000 };
+    int num_sizes = 4;
+    int threads[MAX_ARGS] = { 1, 16, MAX_THREADS };
+    int num_threads = 3;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "s:t:m:c")) != -1) {
+        switch (opt) {
+            case 's':
+                num_sizes = parse_list(optarg, sizes, MAX_ARGS);
+                break;
+            case 't':
+                num_threads = parse_list(optarg, threads, MAX_ARGS);
+                break;
+            case 'm':
+                min_ns = strtoull(optarg, NULL, 10) * 1000000;
+                break;
+            case 'c':
+                csv = true;
+                break;
+            default:
+                usage();
+        }
+    }
+    if (num_sizes <= 0 || num_threads <= 0 || optind < argc - 1) {
+        usage();
+    }
+    for (int i = 0; i < num_threads; i++) {
+        if (threads[i] > MAX_THREADS) {
+            fprintf(stderr, "gdb_bench: at most %d threads are supported\n", MAX_THREADS);
+            return 1;
+        }
+    }
+    const char *filter = (optind < argc) ? argv[optind] : NULL;
+
+    if (csv) {
+        printf("benchmark,size,threads,ns_per_op,bytes_per_op,mb_per_s,syscalls_per_op\n");
+    } else {
+        printf("%-24s %6s %7s %12s %8s %10s %12s\n", "benchmark", "size", "threads", "ns/op", "B/op", "MB/s",
+               "syscalls/op");
+    }
+
+    for (int i = 0; i < sizeof(benches) / sizeof(benches[0]); i++) {
+        bench_t *b = &benches[i];
+        if (filter != NULL && strstr(b->name, filter) == NULL) {
+            continue;
+        }
+
+        for (int s = 0; s < (b->sized ? num_sizes : 1); s++) {
+            for (int t = 0; t < (b->threaded ? num_threads : 1); t++) {
+                measure(b, b->sized ? sizes[s] : 0, b->threaded ? threads[t] : 1);
+            }
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,13 @@
+/*
+ * Copyright 2025, UNSW
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#pragma once
+
+/* What a Cortex-A53 has */
+#define seL4_NumExclusiveBreakpoints 6
+#define seL4_NumExclusiveWatchpoints 4
+#define seL4_FirstBreakpoint 0
+#define seL4_FirstWatchpoint seL4_NumExclusiveBreakpoints
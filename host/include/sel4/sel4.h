@@ -0,0 +1,92 @@
+/*
+ * Copyright 2025, UNSW
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+/*
+ * The parts of libsel4 that libgdb uses, for building it on the host against the simulated kernel
+ * in sel4_sim.c. Values and layouts follow the real AArch64 headers.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <sel4/sel4_arch/types.h>
+#include <sel4/constants.h>
+
+#define PURE __attribute__((__pure__))
+
+typedef enum {
+    seL4_NoError = 0,
+    seL4_InvalidArgument,
+    seL4_InvalidCapability,
+    seL4_IllegalOperation,
+    seL4_RangeError,
+    seL4_AlignmentError,
+    seL4_FailedLookup,
+    seL4_TruncatedMessage,
+    seL4_DeleteFirst,
+    seL4_RevokeFirst,
+    seL4_NotEnoughMemory,
+} seL4_Error;
+
+typedef enum {
+    seL4_DataBreakpoint = 0,
+    seL4_InstructionBreakpoint,
+    seL4_SingleStep,
+    seL4_SoftwareBreakRequest,
+} seL4_BreakpointType;
+
+typedef enum {
+    seL4_BreakOnRead = 0,
+    seL4_BreakOnWrite,
+    seL4_BreakOnReadWrite,
+} seL4_BreakpointAccess;
+
+enum {
+    seL4_Fault_NullFault = 0,
+    seL4_Fault_CapFault,
+    seL4_Fault_UnknownSyscall,
+    seL4_Fault_UserException,
+    seL4_Fault_DebugException,
+    seL4_Fault_VMFault,
+};
+
+enum {
+    seL4_DebugException_FaultIP = 0,
+    seL4_DebugException_ExceptionReason,
+    seL4_DebugException_TriggerAddress,
+    seL4_DebugException_BreakpointNumber,
+    seL4_DebugException_Length,
+};
+
+typedef struct {
+    int error;
+    seL4_Word value;
+} seL4_ARM_VSpace_Read_Word_t;
+
+typedef struct {
+    int error;
+    seL4_Bool bp_was_consumed;
+} seL4_TCB_ConfigureSingleStepping_t;
+
+seL4_Word seL4_GetMR(int i);
+void seL4_SetMR(int i, seL4_Word mr);
+
+seL4_Error seL4_TCB_ReadRegisters(seL4_CPtr tcb, seL4_Bool suspend_source, seL4_Uint8 arch_flags,
+                                  seL4_Word count, seL4_UserContext *regs);
+seL4_Error seL4_TCB_WriteRegisters(seL4_CPtr tcb, seL4_Bool resume_target, seL4_Uint8 arch_flags,
+                                   seL4_Word count, seL4_UserContext *regs);
+seL4_Error seL4_TCB_Suspend(seL4_CPtr tcb);
+seL4_Error seL4_TCB_Resume(seL4_CPtr tcb);
+seL4_Error seL4_TCB_SetBreakpoint(seL4_CPtr tcb, seL4_Uint16 bp_num, seL4_Word vaddr, seL4_Word type,
+                                  seL4_Word size, seL4_Word rw);
+seL4_Error seL4_TCB_UnsetBreakpoint(seL4_CPtr tcb, seL4_Uint16 bp_num);
+seL4_TCB_ConfigureSingleStepping_t seL4_TCB_ConfigureSingleStepping(seL4_CPtr tcb, seL4_Uint16 bp_num,
+                                                                    seL4_Word num_instructions);
+seL4_ARM_VSpace_Read_Word_t seL4_ARM_VSpace_Read_Word(seL4_CPtr vspace, seL4_Word vaddr);
+seL4_Error seL4_ARM_VSpace_Write_Word(seL4_CPtr vspace, seL4_Word vaddr, seL4_Word value);
+
+/* The libc of a real seL4 system has this, but glibc only does from 2.38 */
+size_t strlcpy(char *dest, const char *src, size_t size);
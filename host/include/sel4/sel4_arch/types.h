@@ -0,0 +1,22 @@
+/*
+ * Copyright 2025, UNSW
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+typedef uint64_t seL4_Word;
+typedef seL4_Word seL4_CPtr;
+typedef uint8_t seL4_Uint8;
+typedef uint16_t seL4_Uint16;
+typedef int8_t seL4_Bool;
+
+/* Same layout as the real AArch64 one, which regs2hex and hex2regs depend on */
+typedef struct seL4_UserContext_ {
+    seL4_Word pc, sp, spsr, x0, x1, x2, x3, x4, x5, x6, x7, x8, x16, x17, x18, x29, x30,
+              x9, x10, x11, x12, x13, x14, x15, x19, x20, x21, x22, x23, x24, x25, x26, x27, x28,
+              tpidr_el0, tpidrro_el0;
+} seL4_UserContext;
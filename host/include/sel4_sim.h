@@ -0,0 +1,82 @@
+/*
+ * Copyright 2025, UNSW
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+/*
+ * A simulated seL4 kernel for running libgdb on the host. TCBs are register files, VSpaces are
+ * host memory mapped at the addresses the inferior would see, and every system call libgdb makes is
+ * counted so that a benchmark can report how many a packet costs.
+ */
+
+#pragma once
+
+#include <sel4/sel4.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#define SIM_MAX_TCBS 1024
+#define SIM_MAX_VSPACES 16
+#define SIM_MAX_MAPPINGS 64
+#define SIM_MAX_BREAKPOINTS (seL4_NumExclusiveBreakpoints + seL4_NumExclusiveWatchpoints)
+
+typedef struct sim_breakpoint {
+    bool set;
+    seL4_Word vaddr;
+    seL4_Word type;
+    seL4_Word size;
+    seL4_Word rw;
+} sim_breakpoint_t;
+
+typedef struct sim_tcb {
+    bool allocated;
+    bool suspended;
+    /* Number of instructions left to single step, or 0 if not stepping */
+    seL4_Word single_step;
+    seL4_UserContext regs;
+    sim_breakpoint_t breakpoints[SIM_MAX_BREAKPOINTS];
+} sim_tcb_t;
+
+typedef struct sim_mapping {
+    seL4_Word vaddr;
+    seL4_Word size;
+    unsigned char *mem;
+} sim_mapping_t;
+
+typedef struct sim_vspace {
+    bool allocated;
+    int num_mappings;
+    sim_mapping_t mappings[SIM_MAX_MAPPINGS];
+} sim_vspace_t;
+
+typedef struct sim_syscall_counts {
+    uint64_t read_registers;
+    uint64_t write_registers;
+    uint64_t suspend;
+    uint64_t resume;
+    uint64_t set_breakpoint;
+    uint64_t unset_breakpoint;
+    uint64_t configure_single_stepping;
+    uint64_t vspace_read;
+    uint64_t vspace_write;
+} sim_syscall_counts_t;
+
+extern sim_syscall_counts_t sim_syscalls;
+
+/* Throw away every TCB, VSpace and count */
+void sim_reset(void);
+uint64_t sim_syscall_total(void);
+
+/* Returns a capability for a new TCB or VSpace, or 0 if they have all been used */
+seL4_CPtr sim_tcb_create(void);
+seL4_CPtr sim_vspace_create(void);
+
+/* Returns NULL if tcb is not a TCB capability */
+sim_tcb_t *sim_tcb(seL4_CPtr tcb);
+
+/* Back [vaddr, vaddr + size) of the VSpace with mem, which must stay valid while it is mapped */
+bool sim_vspace_map(seL4_CPtr vspace, seL4_Word vaddr, void *mem, seL4_Word size);
+
+/* Set up the message registers the way the kernel does when a thread takes a debug exception */
+void sim_debug_exception(seL4_Word fault_ip, seL4_Word reason, seL4_Word trigger_address, seL4_Word bp_num);
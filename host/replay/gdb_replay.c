@@ -0,0 +1,484 @@
+/*
+ * Copyright 2025, UNSW
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+/*
+ * Replays a session recorded with gdb_recorder_dump against the host build of libgdb, and reports
+ * where the time went for each type of packet.
+ *
+ * The simulated system is worked out from the recording: every process and thread id that appears
+ * in a packet gets an inferior or thread, and every page GDB reads, writes or puts a breakpoint in is
+ * mapped. Packets from GDB are handled the way the transport would handle them, and the stops the
+ * target reported are turned back into the faults that caused them, so a replay is deterministic
+ * and can be used as a performance test.
+ *
+ * usage: gdb_replay [-n repeats] <recording>
+ */
+
+#include <gdb.h>
+#include <recorder.h>
+#include <util.h>
+#include <sel4_sim.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define PAGE_SIZE 0x1000
+#define MAX_PAGES 4096
+#define MAX_TYPES 64
+#define TYPE_LEN 24
+
+typedef struct record {
+    char direction;
+    int session;
+    uint64_t timestamp;
+    char *payload;
+    uint32_t len;
+} record_t;
+
+typedef struct packet_stats {
+    char type[TYPE_LEN];
+    uint64_t count;
+    uint64_t total_ns;
+    uint64_t max_ns;
+    uint64_t syscalls;
+    /* Time the target took to reply when the session was recorded, in its cycle counter's units */
+    uint64_t recorded_count;
+    uint64_t recorded_cycles;
+} packet_stats_t;
+
+static record_t *records;
+static int num_records;
+
+static int max_tid[MAX_PDS + 1];
+static int pid_session[MAX_PDS + 1];
+static int max_pid;
+
+static seL4_Word pages[MAX_PAGES];
+static int num_pages;
+
+static packet_stats_t stats[MAX_TYPES];
+static int num_types;
+
+static gdb_ctx_t ctx;
+static char input[BUFSIZE];
+static char output[BUFSIZE];
+static char notification[BUFSIZE];
+static bool detached[MAX_SESSIONS];
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void load(const char *path) {
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+        perror(path);
+        exit(1);
+    }
+
+    int capacity = 0;
+    char *line = NULL;
+    size_t line_size = 0;
+    while (getline(&line, &line_size, file) != -1) {
+        char direction, hex[17];
+        int session, offset;
+        if (sscanf(line, "%c %x %16s %n", &direction, &session, hex, &offset) != 3 ||
+            (direction != RECORD_RECEIVED && direction != RECORD_SENT) || session >= MAX_SESSIONS) {
+            /* Anything else in the dump (e.g. console output around it) is skipped */
+            continue;
+        }
+
+        if (num_records == capacity) {
+            capacity = capacity ? capacity * 2 : 1024;
+            records = realloc(records, capacity * sizeof(record_t));
+        }
+
+        record_t *rec = &records[num_records++];
+        rec->direction = direction;
+        rec->session = session;
+        rec->timestamp = strtoull(hex, NULL, 16);
+        rec->len = strcspn(line + offset, "\r\n") / 2;
+        rec->payload = malloc(rec->len + 1);
+        hex2mem(line + offset, rec->payload, rec->len);
+        rec->payload[rec->len] = 0;
+    }
+
+    free(line);
+    fclose(file);
+}
+
+/* The type a packet is reported under: its letter, or its name for the ones that have one */
+static void packet_type(const char *payload, char *type) {
+    if (payload[0] == 3) {
+        strlcpy(type, "^C", TYPE_LEN);
+    } else if (payload[0] == 'q' || payload[0] == 'Q' || payload[0] == 'v') {
+        int len = strcspn(payload, ":,;?");
+        len = (len + 1 < TYPE_LEN) ? len : TYPE_LEN - 1;
+        if (payload[len] == '?') {
+            len++;
+        }
+        memcpy(type, payload, len);
+        type[len] = 0;
+    } else if (payload[0] == 'Z' || payload[0] == 'z') {
+        type[0] = payload[0];
+        type[1] = payload[1];
+        type[2] = 0;
+    } else {
+        type[0] = payload[0];
+        type[1] = 0;
+    }
+}
+
+static packet_stats_t *lookup_stats(const char *type) {
+    for (int i = 0; i < num_types; i++) {
+        if (strcmp(stats[i].type, type) == 0) {
+            return &stats[i];
+        }
+    }
+
+    if (num_types == MAX_TYPES) {
+        return &stats[MAX_TYPES - 1];
+    }
+    strlcpy(stats[num_types].type, type, TYPE_LEN);
+    return &stats[num_types++];
+}
+
+/* Packets with a sequence id start with "xx:", which the transport strips */
+static const char *strip_sequence_id(const char *payload) {
+    return (payload[0] != 0 && payload[1] != 0 && payload[2] == ':') ? payload + 3 : payload;
+}
+
+/* Work out the processes, threads and memory the recorded system had */
+
+static void note_thread_ids(record_t *rec) {
+    for (char *p = rec->payload; (p = strchr(p, 'p')) != NULL; p++) {
+        /* Thread ids follow a separator or the packet that takes them (e.g. "Hgp1.2" or "mp1.2") */
+        if (p == rec->payload || strchr(":;,gcmT\"", p[-1]) == NULL) {
+            continue;
+        }
+
+        seL4_Word pid = 0, tid = 0;
+        char *end = hexstr_to_int(p + 1, sizeof(seL4_Word) * 2, &pid);
+        if (*end == '.') {
+            hexstr_to_int(end + 1, sizeof(seL4_Word) * 2, &tid);
+        }
+        if (pid == 0 || pid > MAX_PDS || tid > MAX_THREADS) {
+            continue;
+        }
+
+        if (pid > max_pid) {
+            max_pid = pid;
+        }
+        if (tid > max_tid[pid]) {
+            max_tid[pid] = tid;
+        }
+        pid_session[pid] = rec->session;
+    }
+}
+
+static void note_page(seL4_Word addr) {
+    seL4_Word page = addr & ~(seL4_Word) (PAGE_SIZE - 1);
+    for (int i = 0; i < num_pages; i++) {
+        if (pages[i] == page) {
+            return;
+        }
+    }
+    if (num_pages < MAX_PAGES) {
+        pages[num_pages++] = page;
+    }
+}
+
+static void note_memory(record_t *rec) {
+    const char *payload = strip_sequence_id(rec->payload);
+    seL4_Word addr = 0, len = 0;
+    char *ptr;
+
+    if (payload[0] == 'm' || payload[0] == 'M' || payload[0] == 'X') {
+        ptr = hexstr_to_int((char *) payload + 1, sizeof(seL4_Word) * 2, &addr);
+        if (*ptr == ',') {
+            hexstr_to_int(ptr + 1, sizeof(seL4_Word) * 2, &len);
+        }
+    } else if ((payload[0] == 'Z' || payload[0] == 'z') && payload[1] != 0 && payload[2] == ',') {
+        ptr = hexstr_to_int((char *) payload + 3, sizeof(seL4_Word) * 2, &addr);
+        len = sizeof(seL4_Word);
+    } else {
+        return;
+    }
+
+    /* A word past the end is mapped too, as memory is accessed a word at a time */
+    for (seL4_Word page = addr & ~(seL4_Word) (PAGE_SIZE - 1); page < addr + len + sizeof(seL4_Word);
+         page += PAGE_SIZE) {
+        note_page(page);
+    }
+}
+
+static int compare_words(const void *a, const void *b) {
+    seL4_Word x = *(const seL4_Word *) a, y = *(const seL4_Word *) b;
+    return (x > y) - (x < y);
+}
+
+static void setup_system(void) {
+    /* The memory of every process, allocated on the first run and zeroed again for each repeat */
+    static unsigned char *memory = NULL;
+
+    sim_reset();
+    gdb_ctx_init(&ctx);
+    memset(detached, 0, sizeof(detached));
+
+    if (max_pid == 0) {
+        max_pid = 1;
+    }
+
+    if (memory == NULL) {
+        qsort(pages, num_pages, sizeof(seL4_Word), compare_words);
+        memory = calloc((size_t) max_pid * num_pages + 1, PAGE_SIZE);
+        if (memory == NULL) {
+            fprintf(stderr, "gdb_replay: out of memory\n");
+            exit(1);
+        }
+    } else {
+        memset(memory, 0, (size_t) max_pid * num_pages * PAGE_SIZE);
+    }
+
+    unsigned char *mem = memory;
+    for (int pid = 1; pid <= max_pid; pid++) {
+        seL4_CPtr vspace = sim_vspace_create();
+
+        /* Runs of adjacent pages are mapped together */
+        for (int i = 0; i < num_pages;) {
+            int j = i + 1;
+            while (j < num_pages && pages[j] == pages[j - 1] + PAGE_SIZE) {
+                j++;
+            }
+            if (!sim_vspace_map(vspace, pages[i], mem, (j - i) * PAGE_SIZE)) {
+                fprintf(stderr, "gdb_replay: too many memory regions, accesses to 0x%lx will fail\n", pages[i]);
+            }
+            mem += (j - i) * PAGE_SIZE;
+            i = j;
+        }
+
+        /* Inferiors and threads are registered in order, so the ids GDB sees match the recording */
+        gdb_register_inferior(&ctx, pid, vspace);
+        gdb_assign_inferior(&ctx, pid, pid_session[pid]);
+        for (int tid = 1; tid <= (max_tid[pid] ? max_tid[pid] : 1); tid++) {
+            gdb_register_thread(&ctx, pid, tid, sim_tcb_create(), output);
+        }
+    }
+
+    /* suspend_system only stops the selected session's inferiors */
+    for (int i = 0; i < MAX_SESSIONS; i++) {
+        gdb_select_session(&ctx, i);
+        suspend_system(&ctx);
+    }
+    gdb_select_session(&ctx, 0);
+}
+
+/* Turn a stop reply back into the fault that caused it. Returns false if it wasn't caused by one
+   (e.g. it was a thread stopped by GDB, or a thread event). */
+static bool inject_fault(const char *reply) {
+    if (strncmp(reply, "%Stop:", 6) == 0) {
+        reply += 6;
+    }
+
+    seL4_Word signal = 0, pid = 0, tid = 0;
+    const char *thread = strstr(reply, "thread:p");
+    if (reply[0] != 'T' || thread == NULL) {
+        return false;
+    }
+    hexstr_to_int((char *) reply + 1, 2, &signal);
+    char *end = hexstr_to_int((char *) thread + 8, sizeof(seL4_Word) * 2, &pid);
+    if (*end == '.') {
+        hexstr_to_int(end + 1, sizeof(seL4_Word) * 2, &tid);
+    }
+    if (pid == 0 || pid > MAX_PDS) {
+        return false;
+    }
+
+    /* libgdb reports every fault that isn't a debug exception as a SIGABRT */
+    seL4_Word exception_reason = seL4_Fault_DebugException;
+    if (signal == 6) {
+        exception_reason = seL4_Fault_UserException;
+    } else if (signal != 5 || strstr(reply, "create") || strstr(reply, "fork") || strstr(reply, "exec")) {
+        return false;
+    }
+
+    const char *watch = strstr(reply, "watch:");
+    if (strstr(reply, "swbreak")) {
+        sim_debug_exception(0, seL4_SoftwareBreakRequest, 0, 0);
+    } else if (strstr(reply, "hwbreak")) {
+        sim_debug_exception(0, seL4_InstructionBreakpoint, 0, 0);
+    } else if (watch != NULL) {
+        seL4_Word addr = 0;
+        hexstr_to_int((char *) watch + 6, sizeof(seL4_Word) * 2, &addr);
+        gdb_inferior_t *inferior = &ctx.inferiors[pid - 1];
+        int n;
+        for (n = 0; n < seL4_NumExclusiveWatchpoints; n++) {
+            hw_watch_t *wp = &inferior->hardware_watchpoints[n];
+            if (wp->size != 0 && addr >= wp->addr && addr < wp->addr + wp->size) {
+                break;
+            }
+        }
+        if (n == seL4_NumExclusiveWatchpoints) {
+            return false;
+        }
+        sim_debug_exception(0, seL4_DataBreakpoint, addr, seL4_FirstWatchpoint + n);
+    } else {
+        sim_debug_exception(0, seL4_SingleStep, 0, 0);
+    }
+
+    seL4_Word reply_mr;
+    bool have_reply;
+    uint64_t syscalls = sim_syscall_total();
+    uint64_t start = now_ns();
+    gdb_handle_fault(&ctx, pid, tid, exception_reason, &reply_mr, output, &have_reply);
+    if (output[0] != 0) {
+        suspend_system(&ctx);
+    }
+    uint64_t elapsed = now_ns() - start;
+
+    packet_stats_t *s = lookup_stats("(fault)");
+    s->count++;
+    s->total_ns += elapsed;
+    s->max_ns = (elapsed > s->max_ns) ? elapsed : s->max_ns;
+    s->syscalls += sim_syscall_total() - syscalls;
+    return true;
+}
+
+static bool is_stop(const record_t *rec) {
+    return rec->payload[0] == 'T' || strncmp(rec->payload, "%Stop:T", 7) == 0;
+}
+
+/* Handle a packet from GDB the way the transport does */
+static void replay_packet(int idx, bool record_latency) {
+    record_t *rec = &records[idx];
+    const char *payload = strip_sequence_id(rec->payload);
+
+    char type[TYPE_LEN];
+    packet_type(payload, type);
+    packet_stats_t *s = lookup_stats(type);
+
+    strlcpy(input, payload, BUFSIZE);
+    gdb_select_session(&ctx, rec->session);
+
+    uint64_t syscalls = sim_syscall_total();
+    uint64_t start = now_ns();
+    if (detached[rec->session] || input[0] == 3) {
+        suspend_system(&ctx);
+        detached[rec->session] = false;
+    }
+    bool resume = gdb_handle_packet(&ctx, input, output, &detached[rec->session]);
+    if (resume) {
+        resume_system(&ctx);
+    }
+    /* The transport sends the rest of a monitor command's output as GDB acks each packet of it */
+    while (gdb_monitor_drain(&ctx, output)) {
+    }
+    gdb_stop_notification(&ctx, notification);
+    uint64_t elapsed = now_ns() - start;
+
+    s->count++;
+    s->total_ns += elapsed;
+    s->max_ns = (elapsed > s->max_ns) ? elapsed : s->max_ns;
+    s->syscalls += sim_syscall_total() - syscalls;
+
+    /* The target's reply to a packet that didn't resume anything is the next thing it sent */
+    if (record_latency && !resume) {
+        for (int i = idx + 1; i < num_records; i++) {
+            if (records[i].session == rec->session && records[i].direction == RECORD_SENT) {
+                s->recorded_count++;
+                s->recorded_cycles += records[i].timestamp - rec->timestamp;
+                break;
+            }
+        }
+    }
+
+    /* Whatever stopped the system next in the recording stops it now */
+    if (resume) {
+        for (int i = idx + 1; i < num_records; i++) {
+            record_t *next = &records[i];
+            if (next->session != rec->session) {
+                continue;
+            }
+            if (next->direction == RECORD_RECEIVED && next->payload[0] == 3) {
+                break;
+            }
+            if (next->direction == RECORD_SENT && is_stop(next)) {
+                inject_fault(next->payload);
+                break;
+            }
+        }
+    }
+}
+
+static int compare_stats(const void *a, const void *b) {
+    uint64_t x = ((const packet_stats_t *) a)->total_ns, y = ((const packet_stats_t *) b)->total_ns;
+    return (x < y) - (x > y);
+}
+
+static void usage(void) {
+    fprintf(stderr, "usage: gdb_replay [-n repeats] <recording>\n");
+    exit(1);
+}
+
+int main(int argc, char **argv) {
+    int repeats = 1;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "n:")) != -1) {
+        switch (opt) {
+            case 'n':
+                repeats = atoi(optarg);
+                break;
+            default:
+                usage();
+        }
+    }
+    if (repeats <= 0 || optind != argc - 1) {
+        usage();
+    }
+
+    load(argv[optind]);
+    for (int i = 0; i < num_records; i++) {
+        note_thread_ids(&records[i]);
+        if (records[i].direction == RECORD_RECEIVED) {
+            note_memory(&records[i]);
+        }
+    }
+
+    int num_packets = 0;
+    for (int r = 0; r < repeats; r++) {
+        setup_system();
+        for (int i = 0; i < num_records; i++) {
+            if (records[i].direction == RECORD_RECEIVED) {
+                replay_packet(i, r == 0);
+                num_packets++;
+            }
+        }
+    }
+
+    printf("Replayed %d packets from %d records (%d processes, %d pages of memory)\n\n", num_packets / repeats,
+           num_records, max_pid, num_pages);
+
+    qsort(stats, num_types, sizeof(packet_stats_t), compare_stats);
+    printf("%-20s %8s %12s %10s %10s %12s %16s\n", "packet", "count", "total us", "mean ns", "max ns",
+           "syscalls/op", "recorded cyc/op");
+    for (int i = 0; i < num_types; i++) {
+        packet_stats_t *s = &stats[i];
+        printf("%-20s %8lu %12.1f %10.1f %10lu %12.2f", s->type, s->count, s->total_ns / 1000.0,
+               (double) s->total_ns / s->count, s->max_ns, (double) s->syscalls / s->count);
+        if (s->recorded_count) {
+            printf(" %16.1f\n", (double) s->recorded_cycles / s->recorded_count);
+        } else {
+            printf(" %16s\n", "-");
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,267 @@
+/*
+ * Copyright 2025, UNSW
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <sel4_sim.h>
+#include <stdio.h>
+#include <string.h>
+
+/*
+ * Capabilities are handed out from two ranges so that passing a TCB where a VSpace is expected (or the
+ * other way around) fails the way it would on a real kernel. 0 is never a valid capability.
+ */
+#define TCB_CAP_BASE 0x100
+#define VSPACE_CAP_BASE (TCB_CAP_BASE + SIM_MAX_TCBS)
+
+sim_syscall_counts_t sim_syscalls;
+
+static sim_tcb_t tcbs[SIM_MAX_TCBS];
+static sim_vspace_t vspaces[SIM_MAX_VSPACES];
+static seL4_Word mrs[seL4_DebugException_Length];
+
+void sim_reset(void) {
+    memset(tcbs, 0, sizeof(tcbs));
+    memset(vspaces, 0, sizeof(vspaces));
+    memset(mrs, 0, sizeof(mrs));
+    memset(&sim_syscalls, 0, sizeof(sim_syscalls));
+}
+
+uint64_t sim_syscall_total(void) {
+    return sim_syscalls.read_registers + sim_syscalls.write_registers + sim_syscalls.suspend +
+           sim_syscalls.resume + sim_syscalls.set_breakpoint + sim_syscalls.unset_breakpoint +
+           sim_syscalls.configure_single_stepping + sim_syscalls.vspace_read + sim_syscalls.vspace_write;
+}
+
+seL4_CPtr sim_tcb_create(void) {
+    for (int i = 0; i < SIM_MAX_TCBS; i++) {
+        if (!tcbs[i].allocated) {
+            memset(&tcbs[i], 0, sizeof(sim_tcb_t));
+            tcbs[i].allocated = true;
+            return TCB_CAP_BASE + i;
+        }
+    }
+
+    return 0;
+}
+
+seL4_CPtr sim_vspace_create(void) {
+    for (int i = 0; i < SIM_MAX_VSPACES; i++) {
+        if (!vspaces[i].allocated) {
+            memset(&vspaces[i], 0, sizeof(sim_vspace_t));
+            vspaces[i].allocated = true;
+            return VSPACE_CAP_BASE + i;
+        }
+    }
+
+    return 0;
+}
+
+sim_tcb_t *sim_tcb(seL4_CPtr tcb) {
+    if (tcb < TCB_CAP_BASE || tcb >= TCB_CAP_BASE + SIM_MAX_TCBS || !tcbs[tcb - TCB_CAP_BASE].allocated) {
+        return NULL;
+    }
+
+    return &tcbs[tcb - TCB_CAP_BASE];
+}
+
+static sim_vspace_t *sim_vspace(seL4_CPtr vspace) {
+    if (vspace < VSPACE_CAP_BASE || vspace >= VSPACE_CAP_BASE + SIM_MAX_VSPACES ||
+        !vspaces[vspace - VSPACE_CAP_BASE].allocated) {
+        return NULL;
+    }
+
+    return &vspaces[vspace - VSPACE_CAP_BASE];
+}
+
+bool sim_vspace_map(seL4_CPtr vspace, seL4_Word vaddr, void *mem, seL4_Word size) {
+    sim_vspace_t *vs = sim_vspace(vspace);
+    if (vs == NULL || vs->num_mappings == SIM_MAX_MAPPINGS) {
+        return false;
+    }
+
+    vs->mappings[vs->num_mappings++] = (sim_mapping_t) { .vaddr = vaddr, .size = size, .mem = mem };
+    return true;
+}
+
+/* The host memory behind a word at vaddr, or NULL if any of it is unmapped. Unaligned words are
+   allowed, as libgdb reads and writes instructions with them. */
+static unsigned char *translate(seL4_CPtr vspace, seL4_Word vaddr) {
+    sim_vspace_t *vs = sim_vspace(vspace);
+    if (vs == NULL) {
+        return NULL;
+    }
+
+    for (int i = 0; i < vs->num_mappings; i++) {
+        sim_mapping_t *m = &vs->mappings[i];
+        if (vaddr >= m->vaddr && vaddr - m->vaddr + sizeof(seL4_Word) <= m->size) {
+            return m->mem + (vaddr - m->vaddr);
+        }
+    }
+
+    return NULL;
+}
+
+void sim_debug_exception(seL4_Word fault_ip, seL4_Word reason, seL4_Word trigger_address, seL4_Word bp_num) {
+    mrs[seL4_DebugException_FaultIP] = fault_ip;
+    mrs[seL4_DebugException_ExceptionReason] = reason;
+    mrs[seL4_DebugException_TriggerAddress] = trigger_address;
+    mrs[seL4_DebugException_BreakpointNumber] = bp_num;
+}
+
+seL4_Word seL4_GetMR(int i) {
+    return (i >= 0 && i < seL4_DebugException_Length) ? mrs[i] : 0;
+}
+
+void seL4_SetMR(int i, seL4_Word mr) {
+    if (i >= 0 && i < seL4_DebugException_Length) {
+        mrs[i] = mr;
+    }
+}
+
+seL4_Error seL4_TCB_ReadRegisters(seL4_CPtr tcb, seL4_Bool suspend_source, seL4_Uint8 arch_flags,
+                                  seL4_Word count, seL4_UserContext *regs) {
+    sim_syscalls.read_registers++;
+    sim_tcb_t *t = sim_tcb(tcb);
+    if (t == NULL) {
+        return seL4_InvalidCapability;
+    }
+    if (count > sizeof(seL4_UserContext) / sizeof(seL4_Word)) {
+        return seL4_RangeError;
+    }
+
+    memcpy(regs, &t->regs, count * sizeof(seL4_Word));
+    return seL4_NoError;
+}
+
+seL4_Error seL4_TCB_WriteRegisters(seL4_CPtr tcb, seL4_Bool resume_target, seL4_Uint8 arch_flags,
+                                   seL4_Word count, seL4_UserContext *regs) {
+    sim_syscalls.write_registers++;
+    sim_tcb_t *t = sim_tcb(tcb);
+    if (t == NULL) {
+        return seL4_InvalidCapability;
+    }
+    if (count > sizeof(seL4_UserContext) / sizeof(seL4_Word)) {
+        return seL4_RangeError;
+    }
+
+    memcpy(&t->regs, regs, count * sizeof(seL4_Word));
+    if (resume_target) {
+        t->suspended = false;
+    }
+    return seL4_NoError;
+}
+
+seL4_Error seL4_TCB_Suspend(seL4_CPtr tcb) {
+    sim_syscalls.suspend++;
+    sim_tcb_t *t = sim_tcb(tcb);
+    if (t == NULL) {
+        return seL4_InvalidCapability;
+    }
+
+    t->suspended = true;
+    return seL4_NoError;
+}
+
+seL4_Error seL4_TCB_Resume(seL4_CPtr tcb) {
+    sim_syscalls.resume++;
+    sim_tcb_t *t = sim_tcb(tcb);
+    if (t == NULL) {
+        return seL4_InvalidCapability;
+    }
+
+    t->suspended = false;
+    return seL4_NoError;
+}
+
+seL4_Error seL4_TCB_SetBreakpoint(seL4_CPtr tcb, seL4_Uint16 bp_num, seL4_Word vaddr, seL4_Word type,
+                                  seL4_Word size, seL4_Word rw) {
+    sim_syscalls.set_breakpoint++;
+    sim_tcb_t *t = sim_tcb(tcb);
+    if (t == NULL) {
+        return seL4_InvalidCapability;
+    }
+    if (bp_num >= SIM_MAX_BREAKPOINTS) {
+        return seL4_RangeError;
+    }
+
+    /* Breakpoint and watchpoint registers can't be used for each other */
+    bool is_watchpoint = bp_num >= seL4_FirstWatchpoint;
+    if (is_watchpoint != (type == seL4_DataBreakpoint)) {
+        return seL4_InvalidArgument;
+    }
+    /* Like mainline seL4, which has no support for DBGWCR.MASK */
+    if (is_watchpoint && size != 1 && size != 2 && size != 4 && size != 8) {
+        return seL4_InvalidArgument;
+    }
+
+    t->breakpoints[bp_num] = (sim_breakpoint_t) { .set = true, .vaddr = vaddr, .type = type, .size = size, .rw = rw };
+    return seL4_NoError;
+}
+
+seL4_Error seL4_TCB_UnsetBreakpoint(seL4_CPtr tcb, seL4_Uint16 bp_num) {
+    sim_syscalls.unset_breakpoint++;
+    sim_tcb_t *t = sim_tcb(tcb);
+    if (t == NULL) {
+        return seL4_InvalidCapability;
+    }
+    if (bp_num >= SIM_MAX_BREAKPOINTS) {
+        return seL4_RangeError;
+    }
+
+    t->breakpoints[bp_num].set = false;
+    return seL4_NoError;
+}
+
+seL4_TCB_ConfigureSingleStepping_t seL4_TCB_ConfigureSingleStepping(seL4_CPtr tcb, seL4_Uint16 bp_num,
+                                                                    seL4_Word num_instructions) {
+    sim_syscalls.configure_single_stepping++;
+    seL4_TCB_ConfigureSingleStepping_t ret = { .error = seL4_NoError, .bp_was_consumed = false };
+    sim_tcb_t *t = sim_tcb(tcb);
+    if (t == NULL) {
+        ret.error = seL4_InvalidCapability;
+        return ret;
+    }
+
+    t->single_step = num_instructions;
+    return ret;
+}
+
+seL4_ARM_VSpace_Read_Word_t seL4_ARM_VSpace_Read_Word(seL4_CPtr vspace, seL4_Word vaddr) {
+    sim_syscalls.vspace_read++;
+    seL4_ARM_VSpace_Read_Word_t ret = { .error = seL4_NoError, .value = 0 };
+    unsigned char *mem = translate(vspace, vaddr);
+    if (mem == NULL) {
+        ret.error = seL4_FailedLookup;
+        return ret;
+    }
+
+    memcpy(&ret.value, mem, sizeof(seL4_Word));
+    return ret;
+}
+
+seL4_Error seL4_ARM_VSpace_Write_Word(seL4_CPtr vspace, seL4_Word vaddr, seL4_Word value) {
+    sim_syscalls.vspace_write++;
+    unsigned char *mem = translate(vspace, vaddr);
+    if (mem == NULL) {
+        return seL4_FailedLookup;
+    }
+
+    memcpy(mem, &value, sizeof(seL4_Word));
+    return seL4_NoError;
+}
+
+size_t strlcpy(char *dest, const char *src, size_t size) {
+    size_t len;
+    for (len = 0; len + 1 < size && src[len]; len++) {
+        dest[len] = src[len];
+    }
+    dest[len] = '\0';
+    return len;
+}
+
+/* printf.c's output goes to the host's stdout */
+void _putchar(char character) {
+    putchar(character);
+}
@@ -0,0 +1,143 @@
+/*
+ * Copyright 2025, UNSW
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+/*
+ * Tests of the agent expressions GDB sends for dprintf, run against the simulated kernel. The formats
+ * are as long as a piece of a printf can be, so that building with -fsanitize=address catches any
+ * write past the end of one.
+ *
+ * usage: agent_test
+ */
+
+#include <gdb.h>
+#include <agent.h>
+#include <util.h>
+#include <sel4_sim.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define INFERIOR_ID 1
+#define THREAD_ID 1
+
+/* The bytecodes the expressions are built from */
+#define AOP_CONST8 0x22
+#define AOP_END 0x27
+#define AOP_PRINTF 0x34
+
+static gdb_ctx_t ctx;
+static gdb_thread_t *thread;
+static char output[BUFSIZE];
+static int failures;
+
+/* printf(format, arg) as GDB compiles it, with the function and channel GDB pushes after the argument */
+static int printf_expr(uint8_t *bytes, const char *format, uint8_t arg) {
+    int len = 0;
+    int slen = strlen(format) + 1;
+    bytes[len++] = AOP_CONST8;
+    bytes[len++] = arg;
+    bytes[len++] = AOP_CONST8;
+    bytes[len++] = 0;
+    bytes[len++] = AOP_CONST8;
+    bytes[len++] = 0;
+    bytes[len++] = AOP_PRINTF;
+    bytes[len++] = 1;
+    bytes[len++] = slen >> 8;
+    bytes[len++] = slen & 0xff;
+    memcpy(bytes + len, format, slen);
+    len += slen;
+    bytes[len++] = AOP_END;
+    return len;
+}
+
+/* Everything the expressions have printed to the console since the last call */
+static const char *console(void) {
+    static char text[CONSOLE_BUFSIZE + 1];
+    int len = 0;
+    while (gdb_console_drain(&ctx, output)) {
+        int n = strlen(output + 1) / 2;
+        hex2mem(output + 1, text + len, n);
+        len += n;
+    }
+    text[len] = 0;
+    return text;
+}
+
+/* Run printf(format, arg), which should succeed and print expected, or fail and print nothing if
+   expected is NULL */
+static void check(const char *what, const char *format, uint8_t arg, const char *expected) {
+    static uint8_t bytes[MAX_BP_COMMAND_BYTES * 2];
+    int len = printf_expr(bytes, format, arg);
+
+    bool ok = agent_eval(&ctx, thread, bytes, len, NULL);
+    const char *got = console();
+    if (ok != (expected != NULL) || strcmp(got, expected ? expected : "") != 0) {
+        fprintf(stderr, "agent_test: %s failed (%s, got \"%s\")\n", what, ok ? "succeeded" : "failed", got);
+        failures++;
+    }
+}
+
+static char *repeat(char *dst, char c, int n) {
+    memset(dst, c, n);
+    return dst + n;
+}
+
+int main(void) {
+    sim_reset();
+    gdb_ctx_init(&ctx);
+    if (gdb_register_inferior(&ctx, INFERIOR_ID, sim_vspace_create()) != DebuggerError_NoError ||
+        gdb_register_thread(&ctx, INFERIOR_ID, THREAD_ID, sim_tcb_create(), output) != DebuggerError_NoError) {
+        fprintf(stderr, "agent_test: could not register the inferior\n");
+        return 1;
+    }
+    for (int i = 0; i < MAX_PDS && !thread; i++) {
+        if (ctx.inferiors[i].enabled) {
+            thread = &ctx.inferiors[i].threads[0];
+        }
+    }
+
+    char format[512], expected[512];
+    char *f, *e;
+
+    check("short format", "x=%d\n", 42, "x=42\n");
+
+    /* A conversion right at the end of a piece's worth of literal text */
+    for (int n = 120; n < 260; n++) {
+        f = repeat(format, 'a', n);
+        strcpy(f, "%d");
+        e = repeat(expected, 'a', n);
+        strcpy(e, "42");
+        check("long text then a conversion", format, 42, expected);
+
+        f = repeat(format, 'a', n);
+        strcpy(f, "%%");
+        e = repeat(expected, 'a', n);
+        strcpy(e, "%");
+        check("long text then %%", format, 0, expected);
+
+        f = repeat(format, 'a', n);
+        strcpy(f, "%08lx!");
+        e = repeat(expected, 'a', n);
+        strcpy(e, "0000002a!");
+        check("long text then a conversion with flags", format, 42, expected);
+    }
+
+    /* A conversion that doesn't fit in a piece on its own can't be printed properly */
+    f = repeat(format, 'a', 10);
+    *f++ = '%';
+    f = repeat(f, '0', 200);
+    strcpy(f, "d");
+    check("overlong conversion", format, 42, NULL);
+
+    /* Nor can one whose output doesn't fit */
+    check("overlong output", "%200d", 42, NULL);
+
+    if (failures) {
+        return 1;
+    }
+    printf("agent_test: all passed\n");
+    return 0;
+}
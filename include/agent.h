@@ -0,0 +1,29 @@
+/*
+ * Copyright 2025, UNSW
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#pragma once
+
+#include <gdb.h>
+
+/*
+ * Agent expressions are GDB's bytecode for things that are evaluated on the target without
+ * GDB being involved. We use them for breakpoint commands, which is how GDB implements
+ * `dprintf` when `set dprintf-style agent` is used.
+ */
+
+#define AGENT_STACK_SIZE 32
+
+bp_commands_t *bp_commands_alloc(gdb_ctx_t *ctx);
+void bp_commands_free(bp_commands_t *cmds);
+
+/* Parse the "cmds:persist,Xlen,expr..." suffix of a Z packet */
+bool parse_breakpoint_commands(char *ptr, bp_commands_t *cmds);
+
+/* Evaluate a single agent expression in the context of a stopped thread */
+bool agent_eval(gdb_ctx_t *ctx, gdb_thread_t *thread, uint8_t *bytes, int len, seL4_Word *result);
+
+/* Evaluate all of the commands attached to a breakpoint */
+void run_breakpoint_commands(gdb_ctx_t *ctx, gdb_thread_t *thread, bp_commands_t *cmds);
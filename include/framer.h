@@ -0,0 +1,55 @@
+/*
+ * Copyright 2025, UNSW
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#pragma once
+
+#include <gdb.h>
+
+/*
+ * Incremental framing of the bytes GDB sends us. Transports feed whatever data they have (e.g. a
+ * network buffer) straight into the framer, which copies the packet contents into its own buffer
+ * once and checks them as they go past. Packets can be split over any number of calls.
+ */
+
+typedef enum framer_state {
+    framerState_idle = 0,
+    framerState_packet,
+    /* In a packet too big for buf, which is skipped up to its checksum and then nacked */
+    framerState_discard,
+    framerState_checksum_hi,
+    framerState_checksum_lo,
+} framer_state_t;
+
+typedef enum frame_event {
+    /* All of the data was consumed without anything being completed */
+    frameEvent_none = 0,
+    /* A packet with a valid checksum is in buf, and should be acked with '+' */
+    frameEvent_packet,
+    /* A packet arrived with a bad checksum, and should be nacked with '-' */
+    frameEvent_bad_checksum,
+    /* GDB sent a ctrl-C outside of a packet */
+    frameEvent_interrupt,
+    /* GDB acked or nacked the last packet we sent */
+    frameEvent_ack,
+    frameEvent_nack,
+} frame_event_t;
+
+typedef struct gdb_framer {
+    framer_state_t state;
+    uint8_t cksum;
+    uint8_t xcksum;
+    /* Whether the packet being checksummed was too big and has been discarded */
+    bool discarded;
+    int len;
+    /* Null terminated contents of the last packet */
+    char buf[BUFSIZE];
+} gdb_framer_t;
+
+void gdb_framer_init(gdb_framer_t *framer);
+
+/* Consume data until a frame event happens or it runs out. Returns the number of bytes consumed,
+   so the rest can be passed in again once the event has been dealt with. */
+int gdb_framer_feed(gdb_framer_t *framer, const char *data, int len, frame_event_t *event);
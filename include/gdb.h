@@ -15,31 +15,73 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <sel4/sel4_arch/types.h>
+#include <stats.h>
+#include <monitor.h>
 
 #define MAX_PDS 64
 #define MAX_THREADS 256
 #define MAX_ELF_NAME 32
 #define MAX_SW_BREAKS 32
+#define MAX_PENDING_IGNORES 8
+/* Number of GDB instances that can be attached at once, each to its own set of inferiors */
+#define MAX_SESSIONS 4
 
 // @alwin: All the output strclpy things use this #define. This is quite likely a bad design choice.
 #define BUFSIZE 2048
 
-/* Bookkeeping for watchpoints */
+/* Bookkeeping for watchpoints. A range that GDB asks us to watch may be spread over several
+   hardware slots, each of which covers a naturally aligned, power-of-two sized region. */
 typedef struct watchpoint {
     uint64_t addr;
-    seL4_Word size; //@alwin: No real reason for this to be so big
+    seL4_Word size;
     seL4_BreakpointAccess type;
+    /* The range originally requested by GDB, shared by all the slots used to cover it */
+    uint64_t range_addr;
+    seL4_Word range_size;
 } hw_watch_t;
 
+#define MAX_BP_COMMANDS 16
+#define MAX_BP_COMMAND_BYTES 256
+
+/* Bookkeeping for the target-side commands attached to a breakpoint (see agent.h) */
+typedef struct breakpoint_commands {
+    bool in_use;
+    bool persist;
+    /* Each expression is stored as a 16-bit big-endian length followed by its bytecode */
+    uint16_t len;
+    uint8_t bytes[MAX_BP_COMMAND_BYTES];
+} bp_commands_t;
+
+/* Hit counting for breakpoints. GDB removes and re-inserts breakpoints every time the system
+   stops, so these stay with the slot (tagged by addr) after the breakpoint itself is removed. */
+typedef struct bp_counters {
+    uint64_t addr;
+    uint32_t hits;
+    /* Number of upcoming hits that resume the thread instead of being reported */
+    uint32_t ignore_count;
+} bp_counters_t;
+
 /* Bookkeeping for hardware breakpoints */
 typedef struct hw_breakpoint {
     uint64_t addr;
+    /* Target-side commands (e.g. dprintf) to run instead of stopping, or NULL */
+    struct breakpoint_commands *commands;
+    bp_counters_t counters;
 } hw_break_t;
 
 /* Bookkeeping for software breakpoints */
 typedef struct sw_breakpoint {
     uint64_t addr;
     uint64_t orig_word;
+    /* Target-side commands (e.g. dprintf) to run instead of stopping, or NULL */
+    struct breakpoint_commands *commands;
+    bp_counters_t counters;
+    /* Set for one-shot breakpoints inserted by the debugger itself rather than GDB (Qsel4.TempBreak).
+       These are taken out again before the next stop is reported. */
+    bool temporary;
+    /* If set, a temporary breakpoint only stops the thread in the frame with this stack pointer or
+       an outer one. Hits in deeper frames (e.g. recursive calls) are stepped over. */
+    seL4_Word temporary_sp;
 } sw_break_t;
 
 struct inferior;
@@ -58,6 +100,14 @@ typedef struct thread {
        This is the id that is told to GDB. */
     uint16_t gdb_id;
     seL4_CPtr tcb;
+    /* Address of the breakpoint the thread is being stepped over, or 0 */
+    seL4_Word step_over_addr;
+    /* While range stepping (vCont;r), single-steps with the pc in [range_start, range_end) are not reported */
+    seL4_Word range_start;
+    seL4_Word range_end;
+    /* Whether GDB considers the thread stopped, and the signal it last stopped with */
+    bool stopped;
+    uint8_t stop_signal;
 } gdb_thread_t;
 
 /* GDB uses 'inferiors' to distinguish between different processes (in our case PDs) */
@@ -70,13 +120,84 @@ struct inferior {
        This is the id that is told to GDB. */
     uint16_t gdb_id;
     seL4_CPtr vspace;
+    /* The session (i.e. GDB instance) this inferior is debugged by */
+    uint8_t session;
+    /* The debugger's statistics, which kernel invocations on this inferior are counted in */
+    gdb_stats_t *stats;
+    /* Set once the kernel has refused a watchpoint region larger than a doubleword */
+    bool watchpoint_mask_unsupported;
     int curr_thread_idx;
     gdb_thread_t threads[MAX_THREADS];
     sw_break_t software_breakpoints[MAX_SW_BREAKS];
     hw_break_t hardware_breakpoints[seL4_NumExclusiveBreakpoints];
     hw_watch_t hardware_watchpoints[seL4_NumExclusiveWatchpoints];
+    /* Ignore counts from "monitor ignore" for breakpoints that are not inserted yet. Whichever kind of
+       breakpoint is inserted at addr next takes the count over. */
+    bp_counters_t pending_ignores[MAX_PENDING_IGNORES];
 };
 
+#define MAX_PENDING_STOPS 64
+#define STOP_REPLY_SIZE 64
+#define CONSOLE_BUFSIZE 4096
+
+/* Everything GDB-facing is kept per session, so that several GDBs can each debug their own subset of
+   the inferiors at the same time without seeing each other's threads or stops */
+typedef struct session {
+    gdb_thread_t *target_thread;
+
+    /* Stop events that GDB has not been told about yet.
+       In non-stop mode (QNonStop:1) only the threads that stop are suspended, and the head of the queue
+       is the stop GDB has most recently been told about. It is removed when GDB acknowledges it with
+       vStopped.
+       In all-stop mode, stops that happen while GDB is still looking at an earlier one are kept here and
+       reported one at a time in place of resuming the system. */
+    bool non_stop;
+    char pending_stops[MAX_PENDING_STOPS][STOP_REPLY_SIZE];
+    gdb_thread_t *pending_stop_threads[MAX_PENDING_STOPS];
+    uint32_t pending_stops_head;
+    uint32_t pending_stops_tail;
+    /* Whether a %Stop notification has been sent that GDB has not finished draining */
+    bool stop_notified;
+    /* Whether GDB has been sent an all-stop stop reply and has not resumed the system since */
+    bool stop_reported;
+
+    /* Thread creations and exits are only reported if GDB asks for them with QThreadEvents:1, and even
+       then only the first one after each resume stops the system. The rest are coalesced, and GDB sees
+       them along with everything else the next time it reads the thread list. */
+    bool thread_events;
+    bool lifecycle_event_reported;
+    /* Where qsThreadInfo carries on listing threads from */
+    int thread_info_inferior_idx;
+    int thread_info_thread_idx;
+
+    /* Target-side console output that has not been sent to GDB yet */
+    char console_buf[CONSOLE_BUFSIZE];
+    uint32_t console_head;
+    uint32_t console_tail;
+
+    /* Output of the last monitor command, until all of it has been sent to GDB */
+    monitor_output_t monitor;
+} gdb_session_t;
+
+/* All of the state of a debugger instance. Nothing in libgdb is global, so a system can have several
+   debugger instances (e.g. one per core, each the fault handler of the PDs on that core), as long as
+   each one is only used by one thread at a time. It must be set up with gdb_ctx_init before use. */
+typedef struct gdb_ctx {
+    int curr_inferior_idx;
+    gdb_inferior_t inferiors[MAX_PDS];
+    /* Which threads a vCont packet has already given an action to */
+    bool handled[MAX_PDS][MAX_THREADS];
+    /* Pool of breakpoint commands, used by the inferiors' breakpoints */
+    bp_commands_t bp_commands[MAX_BP_COMMANDS];
+    gdb_session_t sessions[MAX_SESSIONS];
+    /* The session that packets are being handled for, or that the event being reported belongs to */
+    int session_idx;
+    gdb_session_t *session;
+    gdb_stats_t stats;
+    monitor_command_t monitor_commands[MAX_MONITOR_COMMANDS];
+    int num_monitor_commands;
+} gdb_ctx_t;
+
 typedef enum continue_type {
     ctype_dont = 0,
     ctype_continue,
@@ -91,8 +212,13 @@ enum DebuggerError {
 };
 typedef enum DebuggerError DebuggerError;
 
-void suspend_system();
-void resume_system();
+void gdb_ctx_init(gdb_ctx_t *ctx);
+
+void suspend_system(gdb_ctx_t *ctx);
+void resume_system(gdb_ctx_t *ctx);
+
+int free_sw_breakpoint_slot(gdb_inferior_t *inferior, seL4_Word address);
+int free_hw_breakpoint_slot(gdb_inferior_t *inferior, seL4_Word address);
 
 bool set_software_breakpoint(gdb_inferior_t *inferior, seL4_Word address);
 bool thread_enable_nth_hw_breakpoint(gdb_thread_t *thread, int n);
@@ -110,23 +236,72 @@ bool unset_hardware_watchpoint(gdb_inferior_t *inferior, seL4_Word address,
 bool enable_single_step(gdb_thread_t *thread);
 bool disable_single_step(gdb_thread_t *thread);
 
+bool begin_step_over(gdb_thread_t *thread, seL4_Word address);
+bool end_step_over(gdb_thread_t *thread);
+
 /* Convert registers to a hex string */
 char *regs2hex(seL4_UserContext *regs, char *buf);
 
 /* Convert registers to a hex string */
 char *hex2regs(seL4_UserContext *regs, char *buf);
 
+/* Look up a register by its GDB register number */
+bool regs_read_by_num(seL4_UserContext *regs, int num, seL4_Word *value);
+
+/* Read just the stack pointer of a thread */
+bool thread_read_sp(gdb_thread_t *thread, seL4_Word *sp);
+
+bool inf_read_mem(gdb_thread_t *thread, seL4_Word mem, char *buf, int size);
+
 char *inf_mem2hex(gdb_thread_t *inferior, seL4_Word mem, char *buf, int size, seL4_Word *error);
 seL4_Word inf_hex2mem(gdb_thread_t *inferior, char *buf, seL4_Word mem, int size);
 
-DebuggerError gdb_register_inferior(uint64_t inferior_id, seL4_CPtr vspace);
-DebuggerError gdb_register_thread(uint64_t inferior_id, uint64_t id, seL4_CPtr tcb, char *output);
+DebuggerError gdb_register_inferior(gdb_ctx_t *ctx, uint64_t inferior_id, seL4_CPtr vspace);
+/* Inferiors start off in session 0. Each session is a separate GDB connection that only sees, stops
+   and resumes the inferiors assigned to it. */
+DebuggerError gdb_assign_inferior(gdb_ctx_t *ctx, uint64_t inferior_id, int session);
+/* Packets given to gdb_handle_packet are handled on behalf of the selected session. Faults and
+   thread events select the session of the inferior they happened in. */
+void gdb_select_session(gdb_ctx_t *ctx, int session);
+int gdb_selected_session(gdb_ctx_t *ctx);
+/* Thread creations and exits only leave a stop reply in output when GDB has asked for thread events,
+   and only for the first one since GDB last resumed the system. The rest are picked up by GDB from
+   the thread list, so output is usually left empty. */
+DebuggerError gdb_register_thread(gdb_ctx_t *ctx, uint64_t inferior_id, uint64_t id, seL4_CPtr tcb, char *output);
 void gdb_thread_spawn(gdb_thread_t *thread, char *output);
-DebuggerError gdb_thread_exit(uint64_t inferior_id, uint64_t thread_id, char *output);
+DebuggerError gdb_thread_exit(gdb_ctx_t *ctx, uint64_t inferior_id, uint64_t thread_id, char *output);
 
 // int gdb_register_inferior_fork(uint8_t id, char *output);
 // int gdb_register_inferior_exec(uint8_t id, char *elf_name, seL4_CPtr tcb, seL4_CPtr vspace, char *output);
-DebuggerError gdb_handle_fault(uint64_t inferior_id, uint64_t thread_id, seL4_Word exception_reason,
+
+/* If output is left empty, there is nothing to send to GDB right now and the rest of the system
+   should be left running. Either the fault was dealt with inside libgdb (e.g. a dprintf), or the
+   thread has been stopped and its stop queued because GDB has not finished with an earlier one.
+   Queued stops are reported in place of the next resume (all-stop) or through vStopped (non-stop). */
+DebuggerError gdb_handle_fault(gdb_ctx_t *ctx, uint64_t inferior_id, uint64_t thread_id, seL4_Word exception_reason,
                                seL4_Word *reply_mr, char *output, bool* have_reply);
-bool gdb_handle_packet(char *input, char *output, bool *detached);
+bool gdb_handle_packet(gdb_ctx_t *ctx, char *input, char *output, bool *detached);
+
+/* In non-stop mode, stop replies are sent as asynchronous %Stop notifications. This writes the
+   notification to output if one should be sent now, which is the case when a stop has been queued
+   and GDB is not still draining earlier ones with vStopped. */
+bool gdb_stop_notification(gdb_ctx_t *ctx, char *output);
+
+/* Target-side console output (e.g. from dprintf) is buffered until it can be sent to GDB */
+void gdb_console_write(gdb_ctx_t *ctx, const char *buf, int len);
+bool gdb_console_pending(gdb_ctx_t *ctx);
+/* Fill output with an 'O' packet holding buffered console output. Returns false if there is none. */
+bool gdb_console_drain(gdb_ctx_t *ctx, char *output);
+
+/* Add a "monitor <name>" command. The strings must stay valid for as long as the context is used. */
+DebuggerError gdb_register_monitor_command(gdb_ctx_t *ctx, const char *name, const char *help,
+                                           gdb_monitor_fn_t fn, void *cookie);
+/* Run the monitor command in a qRcmd packet, leaving the first packet of its reply in output */
+void gdb_monitor_handle(gdb_ctx_t *ctx, char *ptr, char *output);
+/* For monitor command handlers to write their output with */
+void gdb_monitor_write(gdb_ctx_t *ctx, const char *buf, int len);
+int gdb_monitor_printf(gdb_ctx_t *ctx, const char *format, ...);
+/* Fill output with the next packet of the reply to a monitor command: an 'O' packet with more of its
+   output, or the final OK/E01. Returns false once the whole reply has been sent. */
+bool gdb_monitor_drain(gdb_ctx_t *ctx, char *output);
 
@@ -0,0 +1,48 @@
+/*
+ * Copyright 2025, UNSW
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * "monitor" commands (qRcmd packets). A command is looked up by its first word, and its handler gets
+ * the rest of the line. libgdb registers its own commands (see "monitor help") and the debugger
+ * component can add more with gdb_register_monitor_command.
+ *
+ * Handlers write their output with gdb_monitor_printf/gdb_monitor_write. It is buffered per session
+ * and streamed to GDB as 'O' packets once the handler has returned, one packet per ack, and followed
+ * by OK (or E01 if the handler failed). A command's output is not limited to one packet, but anything
+ * past MONITOR_BUFSIZE bytes is dropped.
+ */
+
+#define MAX_MONITOR_COMMANDS 16
+#define MONITOR_BUFSIZE 8192
+
+struct gdb_ctx;
+
+/* Returns 0 on success, or -1 to fail the command with an error reply */
+typedef int (*gdb_monitor_fn_t)(struct gdb_ctx *ctx, char *args, void *cookie);
+
+typedef struct monitor_command {
+    const char *name;
+    /* One line of usage, shown by "monitor help" */
+    const char *help;
+    gdb_monitor_fn_t fn;
+    void *cookie;
+} monitor_command_t;
+
+/* The output of the monitor command GDB is waiting on, kept per session */
+typedef struct monitor_output {
+    char buf[MONITOR_BUFSIZE];
+    uint32_t len;
+    /* How much of buf has been sent to GDB */
+    uint32_t sent;
+    /* Whether the final OK/E01 is still to be sent */
+    bool pending;
+    bool failed;
+} monitor_output_t;
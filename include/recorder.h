@@ -0,0 +1,40 @@
+/*
+ * Copyright 2025, UNSW
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#pragma once
+
+#include <gdb.h>
+
+/*
+ * A record of the packets that went each way over a transport, with the time each one did, for
+ * finding out what a slow session spent its time on. Records go into a ring buffer given by the
+ * user, and the oldest ones are dropped to make space for new ones. Dumps can be replayed against
+ * the host build of libgdb with gdb_replay.
+ *
+ * Timestamps come from read_cycle_counter(), so are 0 unless the cycle counter can be read.
+ */
+
+#define RECORD_RECEIVED 'R'
+#define RECORD_SENT 'S'
+
+typedef struct gdb_recorder {
+    char *buf;
+    uint32_t size;
+    /* Where the oldest record starts and the next one goes. These only ever increase, and are
+       taken modulo size to index buf. */
+    uint64_t head;
+    uint64_t tail;
+    /* Records that were dropped to make space, or that were too big to ever fit */
+    uint64_t dropped;
+} gdb_recorder_t;
+
+void gdb_recorder_init(gdb_recorder_t *rec, char *buf, uint32_t size);
+void gdb_recorder_log(gdb_recorder_t *rec, char direction, int session, const char *payload, uint32_t len);
+
+/* Write out every record, oldest first, as a line of "<direction> <session> <timestamp> <payload>"
+   with the timestamp and payload in hex. out can be called with any part of a line. */
+void gdb_recorder_dump(gdb_recorder_t *rec, void (*out)(void *cookie, const char *buf, uint32_t len),
+                       void *cookie);
@@ -0,0 +1,159 @@
+/*
+ * Copyright 2025, UNSW
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * A lock-free single-producer/single-consumer byte ring in shared memory, for passing the raw RSP
+ * byte stream between protection domains (e.g. a network PD and the debugger) that may be running
+ * on different cores. The region only needs to be zeroed to start with, which Microkit does for us,
+ * so neither side has to wait for the other to set it up.
+ *
+ * The producer only ever writes tail and the consumer only ever writes head. Each index is
+ * published with a release store after the data it covers, and read with an acquire load before
+ * touching that data. They are kept on separate cache lines so the two sides don't contend.
+ *
+ * A producer that finds the ring full can ask to be told when there is space again with
+ * spsc_ring_request_space_signal, and the consumer checks for that with spsc_ring_take_space_signal
+ * after consuming. How the producer is told (e.g. a notification) is up to the user.
+ *
+ * The producer can also have the consumer throw away everything in the ring, e.g. when the stream it
+ * carries starts over. It asks with spsc_ring_request_reset and writes nothing more until
+ * spsc_ring_reset_pending says the consumer has done so with spsc_ring_take_reset.
+ */
+
+#define SPSC_RING_CACHE_LINE 64
+
+typedef struct spsc_ring {
+    /* Free running, so that head == tail means empty */
+    uint32_t head;
+    /* The last reset the consumer has done */
+    uint32_t reset_done;
+    uint8_t head_pad[SPSC_RING_CACHE_LINE - 2 * sizeof(uint32_t)];
+    uint32_t tail;
+    /* Set by the producer when it is waiting for space, and cleared by the consumer */
+    uint32_t space_wanted;
+    /* Counts the resets the producer has asked for */
+    uint32_t reset_requested;
+    uint8_t tail_pad[SPSC_RING_CACHE_LINE - 3 * sizeof(uint32_t)];
+    char data[];
+} spsc_ring_t;
+
+typedef struct spsc_ring_handle {
+    spsc_ring_t *ring;
+    /* Must be a power of two */
+    uint32_t capacity;
+} spsc_ring_handle_t;
+
+/* Use a shared region of region_size bytes as a ring. The largest power of two that fits after the
+   indices is used for the data. */
+static inline void spsc_ring_init(spsc_ring_handle_t *handle, void *region, uint32_t region_size)
+{
+    uint32_t capacity = 1;
+    while (capacity * 2 <= region_size - sizeof(spsc_ring_t)) {
+        capacity *= 2;
+    }
+
+    handle->ring = (spsc_ring_t *) region;
+    handle->capacity = capacity;
+}
+
+static inline uint32_t spsc_ring_length(spsc_ring_handle_t *handle)
+{
+    uint32_t tail = __atomic_load_n(&handle->ring->tail, __ATOMIC_ACQUIRE);
+    uint32_t head = __atomic_load_n(&handle->ring->head, __ATOMIC_ACQUIRE);
+    return tail - head;
+}
+
+/* Producer: copy in as much of buf as will fit. Returns the number of bytes written. */
+static inline uint32_t spsc_ring_write(spsc_ring_handle_t *handle, const char *buf, uint32_t len)
+{
+    spsc_ring_t *ring = handle->ring;
+    uint32_t tail = __atomic_load_n(&ring->tail, __ATOMIC_RELAXED);
+    uint32_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+
+    uint32_t space = handle->capacity - (tail - head);
+    if (len > space) {
+        len = space;
+    }
+
+    for (uint32_t i = 0; i < len; i++) {
+        ring->data[(tail + i) & (handle->capacity - 1)] = buf[i];
+    }
+
+    __atomic_store_n(&ring->tail, tail + len, __ATOMIC_RELEASE);
+    return len;
+}
+
+/* Consumer: get the next contiguous chunk of data without copying it, or NULL if the ring is empty.
+   It stays valid until it is consumed. */
+static inline char *spsc_ring_peek(spsc_ring_handle_t *handle, uint32_t *len)
+{
+    spsc_ring_t *ring = handle->ring;
+    uint32_t head = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+    uint32_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+    if (head == tail) {
+        return NULL;
+    }
+
+    uint32_t offset = head & (handle->capacity - 1);
+    uint32_t contiguous = handle->capacity - offset;
+    *len = (tail - head < contiguous) ? tail - head : contiguous;
+    return &ring->data[offset];
+}
+
+/* Consumer: hand len bytes from spsc_ring_peek back to the producer */
+static inline void spsc_ring_consume(spsc_ring_handle_t *handle, uint32_t len)
+{
+    uint32_t head = __atomic_load_n(&handle->ring->head, __ATOMIC_RELAXED);
+    __atomic_store_n(&handle->ring->head, head + len, __ATOMIC_RELEASE);
+}
+
+/* Producer: ask the consumer to signal once it has consumed something. The producer should try
+   writing again after this, as the consumer may have made space before it saw the request. */
+static inline void spsc_ring_request_space_signal(spsc_ring_handle_t *handle)
+{
+    __atomic_store_n(&handle->ring->space_wanted, 1, __ATOMIC_SEQ_CST);
+}
+
+/* Consumer: after consuming, whether the producer asked to be signalled. The request is cleared. */
+static inline bool spsc_ring_take_space_signal(spsc_ring_handle_t *handle)
+{
+    return __atomic_exchange_n(&handle->ring->space_wanted, 0, __ATOMIC_SEQ_CST) != 0;
+}
+
+/* Producer: ask the consumer to throw away everything in the ring */
+static inline void spsc_ring_request_reset(spsc_ring_handle_t *handle)
+{
+    uint32_t requested = __atomic_load_n(&handle->ring->reset_requested, __ATOMIC_RELAXED);
+    __atomic_store_n(&handle->ring->reset_requested, requested + 1, __ATOMIC_RELEASE);
+}
+
+/* Either side: whether the producer has asked for a reset that the consumer has not done yet */
+static inline bool spsc_ring_reset_pending(spsc_ring_handle_t *handle)
+{
+    uint32_t requested = __atomic_load_n(&handle->ring->reset_requested, __ATOMIC_ACQUIRE);
+    return __atomic_load_n(&handle->ring->reset_done, __ATOMIC_ACQUIRE) != requested;
+}
+
+/* Consumer: if the producer has asked for a reset, throw away everything in the ring and tell it so.
+   Returns whether there was a reset. */
+static inline bool spsc_ring_take_reset(spsc_ring_handle_t *handle)
+{
+    spsc_ring_t *ring = handle->ring;
+    uint32_t requested = __atomic_load_n(&ring->reset_requested, __ATOMIC_ACQUIRE);
+    if (__atomic_load_n(&ring->reset_done, __ATOMIC_RELAXED) == requested) {
+        return false;
+    }
+
+    __atomic_store_n(&ring->head, __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE), __ATOMIC_RELEASE);
+    __atomic_store_n(&ring->reset_done, requested, __ATOMIC_RELEASE);
+    return true;
+}
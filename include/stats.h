@@ -0,0 +1,94 @@
+/*
+ * Copyright 2025, UNSW
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <util.h>
+
+/*
+ * Counters for what the debugger spends its time on, reported by "monitor stats". Each type of packet
+ * counts how often it was handled, the cycles spent handling it, the bytes it took in and sent back,
+ * and the kernel invocations it caused. Invocations are counted against the last packet (or fault)
+ * to be handled, so e.g. resuming the system after a vCont counts towards the vCont.
+ *
+ * Cycles are only counted when the cycle counter can be read (see read_cycle_counter).
+ */
+
+typedef enum stats_packet {
+    statsPacket_read_regs = 0,
+    statsPacket_write_regs,
+    statsPacket_read_mem,
+    statsPacket_write_mem,
+    statsPacket_query,
+    statsPacket_set_thread,
+    statsPacket_thread_alive,
+    statsPacket_stop_reason,
+    statsPacket_vcont,
+    statsPacket_v,
+    statsPacket_insert_bp,
+    statsPacket_remove_bp,
+    statsPacket_detach,
+    statsPacket_interrupt,
+    /* Not a packet, but gdb_handle_fault */
+    statsPacket_fault,
+    statsPacket_other,
+    statsPacket_count,
+} stats_packet_t;
+
+typedef enum stats_invocation {
+    statsInvocation_read_registers = 0,
+    statsInvocation_write_registers,
+    statsInvocation_suspend,
+    statsInvocation_resume,
+    statsInvocation_set_breakpoint,
+    statsInvocation_unset_breakpoint,
+    statsInvocation_configure_single_stepping,
+    statsInvocation_vspace_read,
+    statsInvocation_vspace_write,
+    statsInvocation_count,
+} stats_invocation_t;
+
+typedef struct stats_counter {
+    uint64_t count;
+    uint64_t cycles;
+} stats_counter_t;
+
+typedef struct packet_counters {
+    stats_counter_t handled;
+    uint64_t bytes_in;
+    uint64_t bytes_out;
+    stats_counter_t invocations[statsInvocation_count];
+} packet_counters_t;
+
+typedef struct gdb_stats {
+    packet_counters_t packets[statsPacket_count];
+    /* The packet being handled, or last handled, and when handling it started */
+    stats_packet_t current;
+    uint64_t start;
+} gdb_stats_t;
+
+void gdb_stats_reset(gdb_stats_t *stats);
+
+/* Start and finish counting a packet (or fault) */
+void gdb_stats_begin(gdb_stats_t *stats, const char *input);
+void gdb_stats_begin_fault(gdb_stats_t *stats);
+void gdb_stats_end(gdb_stats_t *stats, const char *output);
+
+void gdb_stats_invoked(gdb_stats_t *stats, stats_invocation_t invocation, uint64_t cycles);
+
+/* Make a kernel invocation, counting it and the cycles it took */
+#define STATS_INVOKE(stats, invocation, call) ({ \
+    uint64_t stats_start_ = read_cycle_counter(); \
+    __typeof__(call) stats_ret_ = (call); \
+    gdb_stats_invoked((stats), (invocation), read_cycle_counter() - stats_start_); \
+    stats_ret_; \
+})
+
+struct gdb_ctx;
+
+/* The "monitor stats [reset|invocations|<packet>]" command, with the gdb_stats_t as its cookie */
+int gdb_stats_monitor(struct gdb_ctx *ctx, char *args, void *cookie);
@@ -0,0 +1,92 @@
+/*
+ * Copyright 2025, UNSW
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#pragma once
+
+#include <gdb.h>
+#include <framer.h>
+#include <recorder.h>
+
+/*
+ * The byte stream to GDB is provided by the user of libgdb (e.g. a UART, a serial subsystem or a
+ * TCP connection), and everything on top of it (framing, acks, the packet loop, reporting stops
+ * and console output) is done here. Nothing in here ever waits: the transport tells us when there
+ * is new input with gdb_transport_poll(), and we deal with everything that is available.
+ */
+
+typedef struct gdb_transport {
+    /* Passed to every callback */
+    void *cookie;
+    /* Get the next contiguous chunk of received data without copying it, or NULL if there is none.
+       It must stay valid until it is consumed. */
+    char *(*recv_peek)(void *cookie, uint32_t *len);
+    /* Mark len bytes from recv_peek as used */
+    void (*recv_consume)(void *cookie, uint32_t len);
+    /* Queue data to be sent. It does not need to go out until flush is called, which lets a
+       transport send an ack, a packet's framing and its payload together. */
+    void (*send)(void *cookie, const char *buf, uint32_t len);
+    void (*flush)(void *cookie);
+} gdb_transport_t;
+
+/* Connection state for each session (i.e. GDB instance) */
+typedef struct gdb_link {
+    gdb_transport_t *transport;
+
+    /* Packets are framed straight out of the transport's own buffers */
+    gdb_framer_t framer;
+
+    /* Output buffer for console packets sent while the system is running */
+    char console_output[BUFSIZE];
+
+    /* Output buffer for the rest of a monitor command's reply, which is sent a packet at a time */
+    char monitor_output[BUFSIZE];
+
+    /* The stop reply waiting to be sent to GDB. This is kept apart from fault_output so that a fault
+       arriving while a packet is in flight cannot overwrite it. */
+    char stop_reply[BUFSIZE];
+
+    /* The packet we are waiting for GDB to ack, which is resent if GDB nacks it */
+    char *unacked;
+
+    bool detached;
+} gdb_link_t;
+
+/* The transport side of a debugger instance, wrapping its libgdb context */
+typedef struct gdb_transport_ctx {
+    gdb_ctx_t *ctx;
+    gdb_link_t links[MAX_SESSIONS];
+    /* The link of the session libgdb currently has selected */
+    gdb_link_t *link;
+
+    /* Output buffer */
+    char output[BUFSIZE];
+    /* Output buffer for non-stop notifications, which are sent without waiting for an ack */
+    char notification[BUFSIZE];
+    /* Output buffer for gdb_handle_fault */
+    char fault_output[BUFSIZE];
+
+    /* If set, every packet sent or received is recorded here */
+    gdb_recorder_t *recorder;
+} gdb_transport_ctx_t;
+
+void gdb_transport_ctx_init(gdb_transport_ctx_t *tctx, gdb_ctx_t *ctx);
+
+/* Start talking to the GDB for a session over a transport, e.g. once a connection has been accepted.
+   Until this is called, the session's stops and console output are held on to and nothing is sent.
+   Each session needs its own transport (see gdb_assign_inferior). */
+void gdb_transport_init(gdb_transport_ctx_t *tctx, int session, gdb_transport_t *transport);
+
+/* Start recording the packets of every session into recorder, or stop if it is NULL */
+void gdb_transport_record(gdb_transport_ctx_t *tctx, gdb_recorder_t *recorder);
+
+/* Deal with everything a session's transport has received. This should be called whenever new data
+   arrives. */
+void gdb_transport_poll(gdb_transport_ctx_t *tctx, int session);
+
+/* Handle a fault from a debugee and report it to the GDB debugging it once it is able to take it.
+   have_reply is as for gdb_handle_fault. */
+DebuggerError gdb_transport_fault(gdb_transport_ctx_t *tctx, uint64_t inferior_id, uint64_t thread_id,
+                                  seL4_Word exception_reason, bool *have_reply);
@@ -45,5 +45,12 @@ void *memset(void *dest, int c, size_t n);
 int hexchar_to_int(unsigned char c);
 unsigned char int_to_hexchar(int i);
 char *hexstr_to_int(char *hex_str, int max_bytes, seL4_Word *val);
+char *decstr_to_int(char *dec_str, seL4_Word *val);
 char *mem2hex(char *mem, char *buf, int size);
 char *hex2mem(char *buf, char *mem, int size);
+
+/* The cycle counter, or 0 if it can't be read. On AArch64 this is CNTVCT_EL0 (or CNTPCT_EL0), which
+   user level can only read if seL4 is built with KernelArmExportVCNTUser (or KernelArmExportPCNTUser).
+   The kernel's configuration says which one can be used, and GDB_CYCLE_COUNTER forces CNTVCT_EL0 for
+   builds that don't see it. */
+uint64_t read_cycle_counter(void);
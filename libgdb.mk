@@ -18,7 +18,7 @@ endif
 
 
 AARCH64_FILES := $(LIBGDB_DIR)/src/arch/arm/64/gdb.c
-ARCH_INDEP_FILES := $(addprefix $(LIBGDB_DIR)/src/, gdb.c util.c printf.c)
+ARCH_INDEP_FILES := $(addprefix $(LIBGDB_DIR)/src/, gdb.c agent.c framer.c transport.c recorder.c stats.c monitor.c util.c printf.c)
 C_FILES := $(AARCH64_FILES) $(ARCH_INDEP_FILES)
 
 CFLAGS += -I$(MICROKIT_SDK)/board/$(BOARD)/$(MICROKIT_CONFIG)/include \
@@ -0,0 +1,529 @@
+/*
+ * Copyright 2025, UNSW
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <agent.h>
+#include <gdb.h>
+#include <util.h>
+#include <printf.h>
+#include <string.h>
+#ifndef MICROKIT
+#include <assert.h>
+#endif /* MICROKIT */
+
+/* Opcodes from GDB's ax.def. Only the ones needed for conditions and dprintf are implemented. */
+enum agent_op {
+    aop_add = 0x02,
+    aop_sub = 0x03,
+    aop_mul = 0x04,
+    aop_div_signed = 0x05,
+    aop_div_unsigned = 0x06,
+    aop_rem_signed = 0x07,
+    aop_rem_unsigned = 0x08,
+    aop_lsh = 0x09,
+    aop_rsh_signed = 0x0a,
+    aop_rsh_unsigned = 0x0b,
+    aop_log_not = 0x0e,
+    aop_bit_and = 0x0f,
+    aop_bit_or = 0x10,
+    aop_bit_xor = 0x11,
+    aop_bit_not = 0x12,
+    aop_equal = 0x13,
+    aop_less_signed = 0x14,
+    aop_less_unsigned = 0x15,
+    aop_ext = 0x16,
+    aop_ref8 = 0x17,
+    aop_ref16 = 0x18,
+    aop_ref32 = 0x19,
+    aop_ref64 = 0x1a,
+    aop_if_goto = 0x20,
+    aop_goto = 0x21,
+    aop_const8 = 0x22,
+    aop_const16 = 0x23,
+    aop_const32 = 0x24,
+    aop_const64 = 0x25,
+    aop_reg = 0x26,
+    aop_end = 0x27,
+    aop_dup = 0x28,
+    aop_pop = 0x29,
+    aop_zero_ext = 0x2a,
+    aop_swap = 0x2b,
+    aop_pick = 0x32,
+    aop_rot = 0x33,
+    aop_printf = 0x34,
+};
+
+/* Longest string that will be read out of the inferior for a %s conversion */
+#define AGENT_MAX_STRING 128
+
+bp_commands_t *bp_commands_alloc(gdb_ctx_t *ctx) {
+    for (int i = 0; i < MAX_BP_COMMANDS; i++) {
+        bp_commands_t *cmds = &ctx->bp_commands[i];
+        if (!cmds->in_use) {
+            cmds->in_use = true;
+            cmds->persist = false;
+            cmds->len = 0;
+            return cmds;
+        }
+    }
+
+    return NULL;
+}
+
+void bp_commands_free(bp_commands_t *cmds) {
+    if (cmds) {
+        cmds->in_use = false;
+    }
+}
+
+bool parse_breakpoint_commands(char *ptr, bp_commands_t *cmds) {
+    seL4_Word persist = 0;
+
+    if (strncmp(ptr, "cmds:", 5) != 0) {
+        return false;
+    }
+    ptr += 5;
+
+    ptr = hexstr_to_int(ptr, sizeof(seL4_Word) * 2, &persist);
+    if (*ptr++ != ',') {
+        return false;
+    }
+
+    cmds->persist = persist;
+    cmds->len = 0;
+    while (*ptr == 'X') {
+        seL4_Word len = 0;
+        ptr = hexstr_to_int(ptr + 1, sizeof(seL4_Word) * 2, &len);
+        if (*ptr++ != ',' || len == 0 || cmds->len + 2 + len > MAX_BP_COMMAND_BYTES) {
+            return false;
+        }
+
+        cmds->bytes[cmds->len++] = (len >> 8) & 0xff;
+        cmds->bytes[cmds->len++] = len & 0xff;
+        for (seL4_Word i = 0; i < len; i++) {
+            int hi = hexchar_to_int(*ptr++);
+            int lo = hexchar_to_int(*ptr++);
+            if (hi < 0 || lo < 0) {
+                return false;
+            }
+            cmds->bytes[cmds->len++] = (hi << 4) | lo;
+        }
+    }
+
+    return (*ptr == 0 || *ptr == ';');
+}
+
+/* Format a single conversion (or a run of literal text) into the debugger console. Returns false,
+   without printing anything, if the output doesn't fit. */
+static bool agent_printf_piece(gdb_ctx_t *ctx, gdb_thread_t *thread, char *piece, char conv, int lng, seL4_Word arg) {
+    char out[AGENT_MAX_STRING];
+    int n;
+
+    switch (conv) {
+    case 0:
+        n = snprintf(out, sizeof(out), piece, 0);
+        break;
+    case 'd':
+    case 'i':
+        if (lng == 2) {
+            n = snprintf(out, sizeof(out), piece, (long long) arg);
+        } else if (lng == 1) {
+            n = snprintf(out, sizeof(out), piece, (long) arg);
+        } else {
+            n = snprintf(out, sizeof(out), piece, (int) arg);
+        }
+        break;
+    case 'u':
+    case 'x':
+    case 'X':
+    case 'o':
+        if (lng == 2) {
+            n = snprintf(out, sizeof(out), piece, (unsigned long long) arg);
+        } else if (lng == 1) {
+            n = snprintf(out, sizeof(out), piece, (unsigned long) arg);
+        } else {
+            n = snprintf(out, sizeof(out), piece, (unsigned int) arg);
+        }
+        break;
+    case 'c':
+        n = snprintf(out, sizeof(out), piece, (int) arg);
+        break;
+    case 'p':
+        n = snprintf(out, sizeof(out), piece, (void *) arg);
+        break;
+    case 'f':
+    case 'F':
+    case 'e':
+    case 'E':
+    case 'g':
+    case 'G': {
+        /* GDB hands doubles over as their raw bits */
+        union {
+            seL4_Word bits;
+            double value;
+        } d = { .bits = arg };
+        n = snprintf(out, sizeof(out), piece, d.value);
+        break;
+    }
+    case 's': {
+        char str[AGENT_MAX_STRING];
+        int i = 0;
+        for (; i < AGENT_MAX_STRING - 1; i++) {
+            if (!inf_read_mem(thread, arg + i, &str[i], 1) || str[i] == 0) {
+                break;
+            }
+        }
+        str[i] = 0;
+        n = snprintf(out, sizeof(out), piece, str);
+        break;
+    }
+    default:
+        /* Unsupported conversion, print it verbatim so that the user can see what happened */
+        n = strnlen(piece, AGENT_MAX_STRING);
+        strlcpy(out, piece, sizeof(out));
+        break;
+    }
+
+    if (n < 0 || n > (int) sizeof(out) - 1) {
+        return false;
+    }
+    gdb_console_write(ctx, out, n);
+    return true;
+}
+
+/*
+ * Copy the next piece of format, either a run of literal text or a single conversion, into piece.
+ * Text too long for one piece carries on in the next. Returns false if a conversion is too long for
+ * a piece, rather than cutting it short.
+ */
+static bool next_printf_piece(const char **format, char *piece, char *conv, int *lng) {
+    const char *f = *format;
+    int len = 0;
+    *conv = 0;
+    *lng = 0;
+
+    while (*f) {
+        if (f[0] != '%') {
+            if (len >= AGENT_MAX_STRING - 1) break;
+            piece[len++] = *f++;
+            continue;
+        }
+
+        if (f[1] == '%') {
+            if (len >= AGENT_MAX_STRING - 2) break;
+            piece[len++] = *f++;
+            piece[len++] = *f++;
+            continue;
+        }
+
+        if (len > 0) {
+            break;
+        }
+
+        /* Measure the flags, width, precision and length modifiers of the conversion */
+        int spec = 1;
+        while (f[spec] && memchr("-+ #0123456789.hlLqjzt", f[spec], 22)) {
+            spec++;
+        }
+        bool has_conv = (f[spec] != 0);
+        if (has_conv) {
+            spec++;
+        }
+        if (spec > AGENT_MAX_STRING - 1) {
+            return false;
+        }
+
+        for (int i = 0; i < spec; i++) {
+            if (f[i] == 'l' || f[i] == 'j' || f[i] == 'z' || f[i] == 't' || f[i] == 'q') {
+                (*lng)++;
+            }
+            piece[len++] = f[i];
+        }
+        if (has_conv) {
+            *conv = f[spec - 1];
+        }
+        f += spec;
+        break;
+    }
+
+    piece[len] = 0;
+    *format = f;
+    return true;
+}
+
+static bool agent_printf(gdb_ctx_t *ctx, gdb_thread_t *thread, const char *format, int nargs, seL4_Word *args) {
+    char piece[AGENT_MAX_STRING];
+    char conv;
+    int lng;
+
+    /* Nothing is printed unless the whole format can be */
+    for (const char *f = format; *f;) {
+        if (!next_printf_piece(&f, piece, &conv, &lng)) {
+            return false;
+        }
+    }
+
+    int arg = 0;
+    while (*format) {
+        next_printf_piece(&format, piece, &conv, &lng);
+
+        seL4_Word value = 0;
+        if (conv != 0) {
+            if (arg < nargs) {
+                value = args[arg];
+            }
+            arg++;
+        }
+
+        if (!agent_printf_piece(ctx, thread, piece, conv, lng > 2 ? 2 : lng, value)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool agent_eval(gdb_ctx_t *ctx, gdb_thread_t *thread, uint8_t *bytes, int len, seL4_Word *result) {
+    seL4_Word stack[AGENT_STACK_SIZE];
+    int sp = 0;
+    int pc = 0;
+
+    seL4_UserContext regs;
+    bool have_regs = false;
+
+/* Make sure there are at least n bytes of immediate data left in the expression */
+#define NEED_BYTES(n) do { if (pc + (n) > len) return false; } while (0)
+/* Make sure the stack holds at least n values and has space for m more */
+#define NEED_STACK(n, m) do { if (sp < (n) || sp + (m) > AGENT_STACK_SIZE) return false; } while (0)
+
+    while (pc < len) {
+        uint8_t op = bytes[pc++];
+        seL4_Word a, b;
+
+        switch (op) {
+        case aop_add:
+        case aop_sub:
+        case aop_mul:
+        case aop_div_signed:
+        case aop_div_unsigned:
+        case aop_rem_signed:
+        case aop_rem_unsigned:
+        case aop_lsh:
+        case aop_rsh_signed:
+        case aop_rsh_unsigned:
+        case aop_bit_and:
+        case aop_bit_or:
+        case aop_bit_xor:
+        case aop_equal:
+        case aop_less_signed:
+        case aop_less_unsigned:
+            NEED_STACK(2, 0);
+            b = stack[--sp];
+            a = stack[sp - 1];
+            switch (op) {
+            case aop_add: a = a + b; break;
+            case aop_sub: a = a - b; break;
+            case aop_mul: a = a * b; break;
+            case aop_div_signed:
+                if (b == 0) return false;
+                a = (int64_t) a / (int64_t) b;
+                break;
+            case aop_div_unsigned:
+                if (b == 0) return false;
+                a = a / b;
+                break;
+            case aop_rem_signed:
+                if (b == 0) return false;
+                a = (int64_t) a % (int64_t) b;
+                break;
+            case aop_rem_unsigned:
+                if (b == 0) return false;
+                a = a % b;
+                break;
+            case aop_lsh: a = a << b; break;
+            case aop_rsh_signed: a = (int64_t) a >> b; break;
+            case aop_rsh_unsigned: a = a >> b; break;
+            case aop_bit_and: a = a & b; break;
+            case aop_bit_or: a = a | b; break;
+            case aop_bit_xor: a = a ^ b; break;
+            case aop_equal: a = (a == b); break;
+            case aop_less_signed: a = ((int64_t) a < (int64_t) b); break;
+            case aop_less_unsigned: a = (a < b); break;
+            }
+            stack[sp - 1] = a;
+            break;
+        case aop_log_not:
+            NEED_STACK(1, 0);
+            stack[sp - 1] = !stack[sp - 1];
+            break;
+        case aop_bit_not:
+            NEED_STACK(1, 0);
+            stack[sp - 1] = ~stack[sp - 1];
+            break;
+        case aop_ext:
+        case aop_zero_ext: {
+            NEED_BYTES(1);
+            NEED_STACK(1, 0);
+            int bits = bytes[pc++];
+            if (bits > 0 && bits < 64) {
+                seL4_Word mask = (1UL << bits) - 1;
+                a = stack[sp - 1] & mask;
+                if (op == aop_ext && (a & (1UL << (bits - 1)))) {
+                    a |= ~mask;
+                }
+                stack[sp - 1] = a;
+            }
+            break;
+        }
+        case aop_ref8:
+        case aop_ref16:
+        case aop_ref32:
+        case aop_ref64: {
+            NEED_STACK(1, 0);
+            int size = 1 << (op - aop_ref8);
+            seL4_Word value = 0;
+            if (!inf_read_mem(thread, stack[sp - 1], (char *) &value, size)) {
+                return false;
+            }
+            stack[sp - 1] = value;
+            break;
+        }
+        case aop_if_goto:
+            NEED_BYTES(2);
+            NEED_STACK(1, 0);
+            if (stack[--sp]) {
+                pc = (bytes[pc] << 8) | bytes[pc + 1];
+            } else {
+                pc += 2;
+            }
+            break;
+        case aop_goto:
+            NEED_BYTES(2);
+            pc = (bytes[pc] << 8) | bytes[pc + 1];
+            break;
+        case aop_const8:
+        case aop_const16:
+        case aop_const32:
+        case aop_const64: {
+            int size = 1 << (op - aop_const8);
+            NEED_BYTES(size);
+            NEED_STACK(0, 1);
+            a = 0;
+            for (int i = 0; i < size; i++) {
+                a = (a << 8) | bytes[pc++];
+            }
+            stack[sp++] = a;
+            break;
+        }
+        case aop_reg: {
+            NEED_BYTES(2);
+            NEED_STACK(0, 1);
+            int regno = (bytes[pc] << 8) | bytes[pc + 1];
+            pc += 2;
+            if (!have_regs) {
+                int error = STATS_INVOKE(thread->inferior->stats, statsInvocation_read_registers,
+                                         seL4_TCB_ReadRegisters(thread->tcb, false, 0,
+                                                                sizeof(seL4_UserContext) / sizeof(seL4_Word), &regs));
+                if (error) {
+                    return false;
+                }
+                have_regs = true;
+            }
+            if (!regs_read_by_num(&regs, regno, &a)) {
+                return false;
+            }
+            stack[sp++] = a;
+            break;
+        }
+        case aop_end:
+            if (result) {
+                NEED_STACK(1, 0);
+                *result = stack[sp - 1];
+            }
+            return true;
+        case aop_dup:
+            NEED_STACK(1, 1);
+            stack[sp] = stack[sp - 1];
+            sp++;
+            break;
+        case aop_pop:
+            NEED_STACK(1, 0);
+            sp--;
+            break;
+        case aop_swap:
+            NEED_STACK(2, 0);
+            a = stack[sp - 1];
+            stack[sp - 1] = stack[sp - 2];
+            stack[sp - 2] = a;
+            break;
+        case aop_pick: {
+            NEED_BYTES(1);
+            int n = bytes[pc++];
+            NEED_STACK(n + 1, 1);
+            stack[sp] = stack[sp - 1 - n];
+            sp++;
+            break;
+        }
+        case aop_rot:
+            NEED_STACK(3, 0);
+            a = stack[sp - 1];
+            stack[sp - 1] = stack[sp - 2];
+            stack[sp - 2] = stack[sp - 3];
+            stack[sp - 3] = a;
+            break;
+        case aop_printf: {
+            /* nargs, a 16-bit string length and then the NUL terminated format string. The
+               function and channel to print to sit on top of the arguments, and we ignore them. */
+            NEED_BYTES(3);
+            int nargs = bytes[pc++];
+            int slen = (bytes[pc] << 8) | bytes[pc + 1];
+            pc += 2;
+            NEED_BYTES(slen);
+            NEED_STACK(nargs + 2, 0);
+            if (slen == 0 || bytes[pc + slen - 1] != 0) {
+                return false;
+            }
+            const char *format = (const char *) &bytes[pc];
+            pc += slen;
+
+            sp -= 2;
+            seL4_Word args[AGENT_STACK_SIZE];
+            for (int i = 0; i < nargs; i++) {
+                args[i] = stack[--sp];
+            }
+            if (!agent_printf(ctx, thread, format, nargs, args)) {
+                return false;
+            }
+            break;
+        }
+        default:
+            /* Unsupported opcode (floating point, tracing and trace state variables) */
+            return false;
+        }
+    }
+
+#undef NEED_BYTES
+#undef NEED_STACK
+
+    /* Ran off the end without an end opcode */
+    return false;
+}
+
+void run_breakpoint_commands(gdb_ctx_t *ctx, gdb_thread_t *thread, bp_commands_t *cmds) {
+    static const char failed[] = "dprintf: failed to evaluate breakpoint command\n";
+    int pos = 0;
+    while (pos + 2 <= cmds->len) {
+        int len = (cmds->bytes[pos] << 8) | cmds->bytes[pos + 1];
+        pos += 2;
+        if (pos + len > cmds->len) {
+            break;
+        }
+
+        if (!agent_eval(ctx, thread, &cmds->bytes[pos], len, NULL)) {
+            gdb_console_write(ctx, failed, sizeof(failed) - 1);
+        }
+        pos += len;
+    }
+}
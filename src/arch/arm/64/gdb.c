@@ -20,6 +20,11 @@
 #define AARCH64_BREAK_KGDB_DYN_DBG  \
     (AARCH64_BREAK_MON | (KGDB_DYN_DBG_BRK_IMM << 5))
 
+/* Watchpoint related stuff. DBGWCR.BAS selects bytes within a single doubleword, while
+   DBGWCR.MASK can describe any naturally aligned power-of-two region from 8 bytes to 2GiB. */
+#define WATCHPOINT_BAS_MAX  8
+#define WATCHPOINT_MASK_MAX (1UL << 31)
+
 /* Convert registers to a hex string */
 // @alwin: This is rather unpleasant, but the way the seL4_UserContext struct is formatted is annoying
 char *regs2hex(seL4_UserContext *regs, char *buf)
@@ -112,43 +117,99 @@ char *hex2regs(seL4_UserContext *regs, char *buf)
     return buf;
 }
 
-bool set_software_breakpoint(gdb_inferior_t *inferior, seL4_Word address) {
-    sw_break_t tmp;
-    tmp.addr = address;
+/* Offsets of the registers in seL4_UserContext, in the order used by GDB's aarch64 target description */
+static const size_t gdb_reg_offsets[] = {
+    offsetof(seL4_UserContext, x0), offsetof(seL4_UserContext, x1), offsetof(seL4_UserContext, x2),
+    offsetof(seL4_UserContext, x3), offsetof(seL4_UserContext, x4), offsetof(seL4_UserContext, x5),
+    offsetof(seL4_UserContext, x6), offsetof(seL4_UserContext, x7), offsetof(seL4_UserContext, x8),
+    offsetof(seL4_UserContext, x9), offsetof(seL4_UserContext, x10), offsetof(seL4_UserContext, x11),
+    offsetof(seL4_UserContext, x12), offsetof(seL4_UserContext, x13), offsetof(seL4_UserContext, x14),
+    offsetof(seL4_UserContext, x15), offsetof(seL4_UserContext, x16), offsetof(seL4_UserContext, x17),
+    offsetof(seL4_UserContext, x18), offsetof(seL4_UserContext, x19), offsetof(seL4_UserContext, x20),
+    offsetof(seL4_UserContext, x21), offsetof(seL4_UserContext, x22), offsetof(seL4_UserContext, x23),
+    offsetof(seL4_UserContext, x24), offsetof(seL4_UserContext, x25), offsetof(seL4_UserContext, x26),
+    offsetof(seL4_UserContext, x27), offsetof(seL4_UserContext, x28), offsetof(seL4_UserContext, x29),
+    offsetof(seL4_UserContext, x30), offsetof(seL4_UserContext, sp), offsetof(seL4_UserContext, pc),
+    offsetof(seL4_UserContext, spsr),
+};
+
+bool regs_read_by_num(seL4_UserContext *regs, int num, seL4_Word *value)
+{
+    if (num < 0 || num >= sizeof(gdb_reg_offsets) / sizeof(gdb_reg_offsets[0])) {
+        return false;
+    }
 
-    seL4_ARM_VSpace_Read_Word_t ret = seL4_ARM_VSpace_Read_Word(inferior->vspace, address);
-    if (ret.error) {
+    *value = *(seL4_Word *) ((char *) regs + gdb_reg_offsets[num]);
+    return true;
+}
+
+bool thread_read_sp(gdb_thread_t *thread, seL4_Word *sp) {
+    seL4_UserContext regs;
+    /* Only read as far as the stack pointer, which comes straight after the pc */
+    int error = STATS_INVOKE(thread->inferior->stats, statsInvocation_read_registers,
+                             seL4_TCB_ReadRegisters(thread->tcb, false, 0,
+                                                    offsetof(seL4_UserContext, sp) / sizeof(seL4_Word) + 1, &regs));
+    if (error) {
         return false;
     }
-    tmp.orig_word = ret.value;
 
-    /* Overwrite the address with the instruction but preserve everything else */
-    ret.value = (seL4_Word) AARCH64_BREAK_KGDB_DYN_DBG | (0xFFFFFFFF00000000 & ret.value);
+    *sp = regs.sp;
+    return true;
+}
 
-    if (seL4_ARM_VSpace_Write_Word(inferior->vspace, address, ret.value)) {
+/* Replace the instruction at address, leaving the rest of the word it is in untouched */
+static bool write_instruction(gdb_inferior_t *inferior, seL4_Word address, uint32_t instruction) {
+    seL4_ARM_VSpace_Read_Word_t ret = STATS_INVOKE(inferior->stats, statsInvocation_vspace_read,
+                                                   seL4_ARM_VSpace_Read_Word(inferior->vspace, address));
+    if (ret.error) {
         return false;
     }
 
-    int i = 0;
-    for (; i < MAX_SW_BREAKS; i++) {
-        if (inferior->software_breakpoints[i].addr == 0) {
-            inferior->software_breakpoints[i] = tmp;
+    ret.value = (seL4_Word) instruction | (0xFFFFFFFF00000000 & ret.value);
+    return !STATS_INVOKE(inferior->stats, statsInvocation_vspace_write,
+                         seL4_ARM_VSpace_Write_Word(inferior->vspace, address, ret.value));
+}
+
+bool set_software_breakpoint(gdb_inferior_t *inferior, seL4_Word address) {
+    /* GDB re-inserts breakpoints when their conditions or commands change */
+    for (int i = 0; i < MAX_SW_BREAKS; i++) {
+        if (inferior->software_breakpoints[i].addr == address) {
             return true;
         }
     }
 
-    /* Too many sw breakpoints have been set */
-    // @alwin: return value
-    seL4_ARM_VSpace_Write_Word(inferior->vspace, address, tmp.orig_word);
-    return false;
+    int i = free_sw_breakpoint_slot(inferior, address);
+    if (i < 0) {
+        /* Too many sw breakpoints have been set */
+        return false;
+    }
+
+    seL4_ARM_VSpace_Read_Word_t ret = STATS_INVOKE(inferior->stats, statsInvocation_vspace_read,
+                                                   seL4_ARM_VSpace_Read_Word(inferior->vspace, address));
+    if (ret.error) {
+        return false;
+    }
+    seL4_Word orig_word = ret.value;
+
+    /* Overwrite the address with the instruction but preserve everything else */
+    ret.value = (seL4_Word) AARCH64_BREAK_KGDB_DYN_DBG | (0xFFFFFFFF00000000 & ret.value);
+
+    if (STATS_INVOKE(inferior->stats, statsInvocation_vspace_write,
+                     seL4_ARM_VSpace_Write_Word(inferior->vspace, address, ret.value))) {
+        return false;
+    }
+
+    inferior->software_breakpoints[i].addr = address;
+    inferior->software_breakpoints[i].orig_word = orig_word;
+    return true;
 }
 
 bool unset_software_breakpoint(gdb_inferior_t *inferior, seL4_Word address) {
     for (int i = 0; i < MAX_SW_BREAKS; i++) {
         if (inferior->software_breakpoints[i].addr == address) {
-            int err = seL4_ARM_VSpace_Write_Word(inferior->vspace,
-                                                 address,
-                                                 inferior->software_breakpoints[i].orig_word);
+            int err = STATS_INVOKE(inferior->stats, statsInvocation_vspace_write,
+                                   seL4_ARM_VSpace_Write_Word(inferior->vspace, address,
+                                                              inferior->software_breakpoints[i].orig_word));
             if (!err) {
                 inferior->software_breakpoints[i].addr = 0;
             }
@@ -162,17 +223,20 @@ bool unset_software_breakpoint(gdb_inferior_t *inferior, seL4_Word address) {
 }
 
 bool set_hardware_breakpoint(gdb_inferior_t *inferior, seL4_Word address) {
-    int i = 0;
-    for (; i < seL4_NumExclusiveBreakpoints; i++) {
-        if (!inferior->hardware_breakpoints[i].addr) break;
+    for (int i = 0; i < seL4_NumExclusiveBreakpoints; i++) {
+        if (inferior->hardware_breakpoints[i].addr == address) {
+            return true;
+        }
     }
 
-    if (i == seL4_NumExclusiveBreakpoints) return false;
+    int i = free_hw_breakpoint_slot(inferior, address);
+    if (i < 0) return false;
 
     for (int j = 0; j < MAX_THREADS; j++) {
         if (inferior->threads[j].enabled) {
-            seL4_Error err = seL4_TCB_SetBreakpoint(inferior->threads[j].tcb, seL4_FirstBreakpoint + i, address,
-                                                    seL4_InstructionBreakpoint, 0, seL4_BreakOnRead);
+            seL4_Error err = STATS_INVOKE(inferior->stats, statsInvocation_set_breakpoint,
+                                          seL4_TCB_SetBreakpoint(inferior->threads[j].tcb, seL4_FirstBreakpoint + i, address,
+                                                                 seL4_InstructionBreakpoint, 0, seL4_BreakOnRead));
             if (err) {
                 // @alwin: Clean up properly.
                 return false;
@@ -190,8 +254,9 @@ bool thread_enable_nth_hw_breakpoint(gdb_thread_t *thread, int n) {
     if (thread->inferior->hardware_breakpoints[n].addr == 0) return true;
     hw_break_t *bp = &thread->inferior->hardware_breakpoints[n];
 
-    seL4_Error err = seL4_TCB_SetBreakpoint(thread->tcb, seL4_FirstBreakpoint + n, bp->addr,
-                                            seL4_InstructionBreakpoint, 0, seL4_BreakOnRead);
+    seL4_Error err = STATS_INVOKE(thread->inferior->stats, statsInvocation_set_breakpoint,
+                                  seL4_TCB_SetBreakpoint(thread->tcb, seL4_FirstBreakpoint + n, bp->addr,
+                                                         seL4_InstructionBreakpoint, 0, seL4_BreakOnRead));
     if (err) {
         return false;
     }
@@ -212,38 +277,133 @@ bool unset_hardware_breakpoint(gdb_inferior_t *inferior, seL4_Word address) {
 
     for (int j = 0; j < MAX_THREADS; j++) {
         if (inferior->threads[j].enabled) {
-            seL4_TCB_UnsetBreakpoint(inferior->threads[j].tcb, seL4_FirstBreakpoint + i);
+            STATS_INVOKE(inferior->stats, statsInvocation_unset_breakpoint,
+                         seL4_TCB_UnsetBreakpoint(inferior->threads[j].tcb, seL4_FirstBreakpoint + i));
         }
     }
     return true;
 }
 
-bool set_hardware_watchpoint(gdb_inferior_t *inferior, seL4_Word address,
-                             seL4_BreakpointAccess type, seL4_Word size) {
-    int i = 0;
-    for (; i < seL4_NumExclusiveWatchpoints; i++) {
-        if (!inferior->hardware_watchpoints[i].addr) break;
+/* Set watchpoint slot n on every thread in the inferior. Undoes any partial progress on failure. */
+static seL4_Error inferior_set_watchpoint_slot(gdb_inferior_t *inferior, int n, seL4_Word address,
+                                               seL4_BreakpointAccess type, seL4_Word size) {
+    for (int j = 0; j < MAX_THREADS; j++) {
+        if (!inferior->threads[j].enabled) continue;
+
+        seL4_Error err = STATS_INVOKE(inferior->stats, statsInvocation_set_breakpoint,
+                                      seL4_TCB_SetBreakpoint(inferior->threads[j].tcb, seL4_FirstWatchpoint + n, address,
+                                                             seL4_DataBreakpoint, size, type));
+        if (err) {
+            for (int k = 0; k < j; k++) {
+                if (inferior->threads[k].enabled) {
+                    STATS_INVOKE(inferior->stats, statsInvocation_unset_breakpoint,
+                                 seL4_TCB_UnsetBreakpoint(inferior->threads[k].tcb, seL4_FirstWatchpoint + n));
+                }
+            }
+            return err;
+        }
     }
 
-    if (i == seL4_NumExclusiveWatchpoints) return false;
+    return seL4_NoError;
+}
 
+static void inferior_unset_watchpoint_slot(gdb_inferior_t *inferior, int n) {
     for (int j = 0; j < MAX_THREADS; j++) {
         if (inferior->threads[j].enabled) {
-            seL4_Error err = seL4_TCB_SetBreakpoint(inferior->threads[j].tcb, seL4_FirstWatchpoint + i,
-                                                    address, seL4_DataBreakpoint, size, type);
-            if (err) {
-                // @alwin: Clean up properly.
-                return false;
+            STATS_INVOKE(inferior->stats, statsInvocation_unset_breakpoint,
+                         seL4_TCB_UnsetBreakpoint(inferior->threads[j].tcb, seL4_FirstWatchpoint + n));
+        }
+    }
+
+    inferior->hardware_watchpoints[n].addr = 0;
+}
+
+/*
+ * Size of the largest naturally aligned power-of-two region starting at address that fits within
+ * remaining bytes and can be described by a single slot.
+ */
+static seL4_Word watchpoint_region_size(seL4_Word address, seL4_Word remaining, seL4_Word max_region) {
+    seL4_Word region = (address == 0) ? max_region : (address & -address);
+    if (region > max_region) {
+        region = max_region;
+    }
+
+    while (region > remaining) {
+        region >>= 1;
+    }
+
+    return region;
+}
+
+/*
+ * Cover [address, address + size) with regions of at most max_region bytes, one per free slot. Ranges
+ * that need more slots than are free are rejected before any system calls are made. If the kernel
+ * refuses a region, its size is left in failed_size.
+ */
+static seL4_Error set_watchpoint_regions(gdb_inferior_t *inferior, seL4_Word address, seL4_BreakpointAccess type,
+                                         seL4_Word size, seL4_Word max_region, seL4_Word *failed_size) {
+    int free_slots[seL4_NumExclusiveWatchpoints];
+    int num_free = 0;
+    for (int i = 0; i < seL4_NumExclusiveWatchpoints; i++) {
+        if (!inferior->hardware_watchpoints[i].addr) {
+            free_slots[num_free++] = i;
+        }
+    }
+
+    seL4_Word region_addr[seL4_NumExclusiveWatchpoints];
+    seL4_Word region_size[seL4_NumExclusiveWatchpoints];
+    int num_regions = 0;
+    for (seL4_Word curr = address, remaining = size; remaining > 0; num_regions++) {
+        if (num_regions == num_free) return seL4_NotEnoughMemory;
+
+        region_addr[num_regions] = curr;
+        region_size[num_regions] = watchpoint_region_size(curr, remaining, max_region);
+        curr += region_size[num_regions];
+        remaining -= region_size[num_regions];
+    }
+
+    for (int i = 0; i < num_regions; i++) {
+        int n = free_slots[i];
+        seL4_Error err = inferior_set_watchpoint_slot(inferior, n, region_addr[i], type, region_size[i]);
+        if (err) {
+            for (int k = 0; k < i; k++) {
+                inferior_unset_watchpoint_slot(inferior, free_slots[k]);
+                inferior->hardware_watchpoints[free_slots[k]].addr = 0;
             }
+            *failed_size = region_size[i];
+            return err;
         }
+
+        inferior->hardware_watchpoints[n].addr = region_addr[i];
+        inferior->hardware_watchpoints[n].size = region_size[i];
+        inferior->hardware_watchpoints[n].type = type;
+        inferior->hardware_watchpoints[n].range_addr = address;
+        inferior->hardware_watchpoints[n].range_size = size;
     }
 
-    inferior->hardware_watchpoints[i].addr = address;
-    inferior->hardware_watchpoints[i].size = size;
-    inferior->hardware_watchpoints[i].type = type;
+    return seL4_NoError;
+}
 
+/*
+ * Regions larger than a doubleword rely on the kernel accepting DBGWCR.MASK sizes, which mainline
+ * seL4 does not (it only takes 1, 2, 4 or 8 bytes). The first time the kernel rejects one as an
+ * invalid argument, the inferior falls back to doubleword regions, so a large range then needs a
+ * slot per doubleword.
+ */
+bool set_hardware_watchpoint(gdb_inferior_t *inferior, seL4_Word address,
+                             seL4_BreakpointAccess type, seL4_Word size) {
+    if (size == 0 || address + size < address) return false;
 
-    return true;
+    seL4_Word failed_size = 0;
+    if (!inferior->watchpoint_mask_unsupported) {
+        seL4_Error err = set_watchpoint_regions(inferior, address, type, size, WATCHPOINT_MASK_MAX, &failed_size);
+        if (err != seL4_InvalidArgument || failed_size <= WATCHPOINT_BAS_MAX) {
+            return err == seL4_NoError;
+        }
+        inferior->watchpoint_mask_unsupported = true;
+    }
+
+    return set_watchpoint_regions(inferior, address, type, size, WATCHPOINT_BAS_MAX, &failed_size) == seL4_NoError;
 }
 
 bool thread_enable_nth_hw_watchpoint(gdb_thread_t *thread, int n) {
@@ -252,8 +412,9 @@ bool thread_enable_nth_hw_watchpoint(gdb_thread_t *thread, int n) {
     if (thread->inferior->hardware_watchpoints[n].addr == 0) return true;
     hw_watch_t *wp = &thread->inferior->hardware_watchpoints[n];
 
-    seL4_Error err = seL4_TCB_SetBreakpoint(thread->tcb, seL4_FirstWatchpoint + n,
-                                            wp->addr, seL4_DataBreakpoint, wp->size, wp->type);
+    seL4_Error err = STATS_INVOKE(thread->inferior->stats, statsInvocation_set_breakpoint,
+                                  seL4_TCB_SetBreakpoint(thread->tcb, seL4_FirstWatchpoint + n, wp->addr,
+                                                         seL4_DataBreakpoint, wp->size, wp->type));
     if (err) {
         return false;
     }
@@ -263,28 +424,16 @@ bool thread_enable_nth_hw_watchpoint(gdb_thread_t *thread, int n) {
 
 bool unset_hardware_watchpoint(gdb_inferior_t *inferior, seL4_Word address,
                                seL4_BreakpointAccess type, seL4_Word size) {
-    int i = 0;
-    for (; i < seL4_NumExclusiveWatchpoints; i++) {
-        if (inferior->hardware_watchpoints[i].addr == address &&
-            inferior->hardware_watchpoints[i].type == type &&
-            inferior->hardware_watchpoints[i].size == size) {
-
-            inferior->hardware_watchpoints[i].addr = 0;
-
-            break;
-        }
-    }
-
-    if (i == seL4_NumExclusiveWatchpoints) return false;
-
-
-    for (int j = 0; j < MAX_THREADS; j++) {
-        if (inferior->threads[j].enabled) {
-            seL4_TCB_UnsetBreakpoint(inferior->threads[j].tcb, seL4_FirstWatchpoint + i);
+    bool found = false;
+    for (int i = 0; i < seL4_NumExclusiveWatchpoints; i++) {
+        hw_watch_t *wp = &inferior->hardware_watchpoints[i];
+        if (wp->addr && wp->range_addr == address && wp->type == type && wp->range_size == size) {
+            inferior_unset_watchpoint_slot(inferior, i);
+            found = true;
         }
     }
 
-    return true;
+    return found;
 }
 
 bool enable_single_step(gdb_thread_t *thread) {
@@ -294,7 +443,8 @@ bool enable_single_step(gdb_thread_t *thread) {
     // }
 
     thread->ss_enabled = true;
-    seL4_TCB_ConfigureSingleStepping(thread->tcb, 0, 1);
+    STATS_INVOKE(thread->inferior->stats, statsInvocation_configure_single_stepping,
+                 seL4_TCB_ConfigureSingleStepping(thread->tcb, 0, 1));
     return true;
 }
 
@@ -304,7 +454,84 @@ bool disable_single_step(gdb_thread_t *thread) {
     //     return false;
     // }
 
-    seL4_TCB_ConfigureSingleStepping(thread->tcb, 0, 0);
+    thread->ss_enabled = false;
+    STATS_INVOKE(thread->inferior->stats, statsInvocation_configure_single_stepping,
+                 seL4_TCB_ConfigureSingleStepping(thread->tcb, 0, 0));
+    return true;
+}
+
+/*
+ * Move a thread past the breakpoint at address without involving GDB. The breakpoint is taken
+ * out, the thread single-steps the original instruction and end_step_over puts the breakpoint
+ * back. Other threads of the inferior will not stop at the breakpoint while this is happening.
+ */
+bool begin_step_over(gdb_thread_t *thread, seL4_Word address) {
+    gdb_inferior_t *inferior = thread->inferior;
+
+    for (int i = 0; i < MAX_SW_BREAKS; i++) {
+        sw_break_t *bp = &inferior->software_breakpoints[i];
+        if (bp->addr == address && !write_instruction(inferior, address, bp->orig_word)) {
+            return false;
+        }
+    }
+
+    for (int i = 0; i < seL4_NumExclusiveBreakpoints; i++) {
+        if (inferior->hardware_breakpoints[i].addr == address) {
+            STATS_INVOKE(thread->inferior->stats, statsInvocation_unset_breakpoint,
+                         seL4_TCB_UnsetBreakpoint(thread->tcb, seL4_FirstBreakpoint + i));
+        }
+    }
+
+    thread->step_over_addr = address;
+    STATS_INVOKE(thread->inferior->stats, statsInvocation_configure_single_stepping,
+                 seL4_TCB_ConfigureSingleStepping(thread->tcb, 0, 1));
+    return true;
+}
+
+bool end_step_over(gdb_thread_t *thread) {
+    gdb_inferior_t *inferior = thread->inferior;
+    seL4_Word address = thread->step_over_addr;
+    bool success = true;
+
+    thread->step_over_addr = 0;
+
+    /* GDB may have removed the breakpoint in the meantime, in which case it is not in the table anymore */
+    for (int i = 0; i < MAX_SW_BREAKS; i++) {
+        if (inferior->software_breakpoints[i].addr == address) {
+            success &= write_instruction(inferior, address, AARCH64_BREAK_KGDB_DYN_DBG);
+        }
+    }
+
+    for (int i = 0; i < seL4_NumExclusiveBreakpoints; i++) {
+        if (inferior->hardware_breakpoints[i].addr == address) {
+            success &= thread_enable_nth_hw_breakpoint(thread, i);
+        }
+    }
+
+    /* Keep stepping if GDB asked for it */
+    if (!thread->ss_enabled) {
+        STATS_INVOKE(thread->inferior->stats, statsInvocation_configure_single_stepping,
+                     seL4_TCB_ConfigureSingleStepping(thread->tcb, 0, 0));
+    }
+
+    return success;
+}
+
+bool inf_read_mem(gdb_thread_t *thread, seL4_Word mem, char *buf, int size)
+{
+    while (size > 0) {
+        seL4_Word base = mem & ~(sizeof(seL4_Word) - 1);
+        seL4_ARM_VSpace_Read_Word_t ret = STATS_INVOKE(thread->inferior->stats, statsInvocation_vspace_read,
+                                                       seL4_ARM_VSpace_Read_Word(thread->inferior->vspace, base));
+        if (ret.error) {
+            return false;
+        }
+
+        for (int i = mem - base; i < sizeof(seL4_Word) && size > 0; i++, size--, mem++) {
+            *buf++ = ((char *) &ret.value)[i];
+        }
+    }
+
     return true;
 }
 
@@ -316,7 +543,8 @@ bool disable_single_step(gdb_thread_t *thread) {
     seL4_Word curr_word = 0;
     for (i = 0; i < size; i++) {
         if (i % sizeof(seL4_Word) == 0) {
-            seL4_ARM_VSpace_Read_Word_t ret = seL4_ARM_VSpace_Read_Word(thread->inferior->vspace, mem);
+            seL4_ARM_VSpace_Read_Word_t ret = STATS_INVOKE(thread->inferior->stats, statsInvocation_vspace_read,
+                                                           seL4_ARM_VSpace_Read_Word(thread->inferior->vspace, mem));
             if (ret.error) {
                 *error = ret.error;
                 return NULL;
@@ -347,7 +575,8 @@ seL4_Word inf_hex2mem(gdb_thread_t *thread, char *buf, seL4_Word mem, int size)
     seL4_Word curr_word = 0;
     for (i = 0; i < size; i++, mem++) {
         if (i % sizeof(seL4_Word) == 0) {
-            seL4_ARM_VSpace_Read_Word_t ret = seL4_ARM_VSpace_Read_Word(thread->inferior->vspace, mem);
+            seL4_ARM_VSpace_Read_Word_t ret = STATS_INVOKE(thread->inferior->stats, statsInvocation_vspace_read,
+                                                           seL4_ARM_VSpace_Read_Word(thread->inferior->vspace, mem));
             if (ret.error) {
                 return (mem + i);
             }
@@ -360,7 +589,9 @@ seL4_Word inf_hex2mem(gdb_thread_t *thread, char *buf, seL4_Word mem, int size)
         *(((char *) &curr_word) + (i % sizeof(seL4_Word))) = c;
 
         if (i % sizeof(seL4_Word) == sizeof(seL4_Word) - 1 || i == size - 1) {
-            int err = seL4_ARM_VSpace_Write_Word(thread->inferior->vspace, mem + (i/sizeof(seL4_Word)), curr_word);
+            int err = STATS_INVOKE(thread->inferior->stats, statsInvocation_vspace_write,
+                                   seL4_ARM_VSpace_Write_Word(thread->inferior->vspace,
+                                                              mem + (i/sizeof(seL4_Word)), curr_word));
             if (err) {
                 return (mem + i);
             }
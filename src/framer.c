@@ -0,0 +1,96 @@
+/*
+ * Copyright 2025, UNSW
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <framer.h>
+#include <util.h>
+
+void gdb_framer_init(gdb_framer_t *framer) {
+    framer->state = framerState_idle;
+    framer->len = 0;
+    framer->buf[0] = 0;
+}
+
+/* Handle a byte outside of a packet */
+static frame_event_t framer_idle(gdb_framer_t *framer, char c) {
+    switch (c) {
+        case '$':
+            framer->state = framerState_packet;
+            framer->cksum = 0;
+            framer->len = 0;
+            framer->discarded = false;
+            return frameEvent_none;
+        case 3:
+            framer->buf[0] = c;
+            framer->buf[1] = 0;
+            return frameEvent_interrupt;
+        case '+':
+            return frameEvent_ack;
+        case '-':
+            return frameEvent_nack;
+        default:
+            /* Ignore anything else */
+            return frameEvent_none;
+    }
+}
+
+int gdb_framer_feed(gdb_framer_t *framer, const char *data, int len, frame_event_t *event) {
+    *event = frameEvent_none;
+
+    int i = 0;
+    while (i < len && *event == frameEvent_none) {
+        char c = data[i++];
+        switch (framer->state) {
+            case framerState_idle:
+                *event = framer_idle(framer, c);
+                break;
+            case framerState_packet:
+                if (c == '$') {
+                    /* Start again if GDB restarted the packet */
+                    framer->cksum = 0;
+                    framer->len = 0;
+                } else if (c == '#') {
+                    framer->buf[framer->len] = 0;
+                    framer->state = framerState_checksum_hi;
+                } else if (framer->len < BUFSIZE - 1) {
+                    framer->cksum += c;
+                    framer->buf[framer->len++] = c;
+                } else {
+                    /* Too big for us to deal with, so skip the rest of it. Its contents must not
+                       be mistaken for acks or the start of another packet. */
+                    framer->state = framerState_discard;
+                }
+                break;
+            case framerState_discard:
+                if (c == '$') {
+                    framer->state = framerState_packet;
+                    framer->cksum = 0;
+                    framer->len = 0;
+                } else if (c == '#') {
+                    framer->discarded = true;
+                    framer->buf[0] = 0;
+                    framer->state = framerState_checksum_hi;
+                }
+                break;
+            case framerState_checksum_hi:
+                framer->xcksum = hexchar_to_int(c) << 4;
+                framer->state = framerState_checksum_lo;
+                break;
+            case framerState_checksum_lo:
+                framer->xcksum += hexchar_to_int(c);
+                framer->state = framerState_idle;
+                /* A discarded packet is nacked like a corrupted one, so GDB's error handling kicks in */
+                if (framer->discarded) {
+                    framer->discarded = false;
+                    *event = frameEvent_bad_checksum;
+                } else {
+                    *event = (framer->cksum == framer->xcksum) ? frameEvent_packet : frameEvent_bad_checksum;
+                }
+                break;
+        }
+    }
+
+    return i;
+}
@@ -5,6 +5,7 @@
  */
 
 #include <gdb.h>
+#include <agent.h>
 #include <arch/arm/64/gdb.h>
 #include <util.h>
 #include <sel4/constants.h>
@@ -24,63 +25,144 @@
 #define THREAD_ID_ALL (-1)
 #define THREAD_ID_ANY 0
 
-int curr_inferior_idx = 0;
-gdb_inferior_t inferiors[MAX_PDS] = {0};
-gdb_thread_t *target_thread = NULL;
+/* Whether an inferior is visible to the selected session */
+static bool in_session(gdb_ctx_t *ctx, gdb_inferior_t *inferior) {
+    return inferior->enabled && inferior->session == ctx->session_idx;
+}
 
 /* Read registers */
-static void handle_read_regs(char *output) {
+static void handle_read_regs(gdb_ctx_t *ctx, char *output) {
     seL4_UserContext context;
-    int error = seL4_TCB_ReadRegisters(target_thread->tcb, true, 0,
-                                       sizeof(seL4_UserContext) / sizeof(seL4_Word), &context);
+    int error = STATS_INVOKE(&ctx->stats, statsInvocation_read_registers,
+                             seL4_TCB_ReadRegisters(ctx->session->target_thread->tcb, true, 0,
+                                                    sizeof(seL4_UserContext) / sizeof(seL4_Word), &context));
     regs2hex(&context, output);
 }
 
 /* Write registers */
-static void handle_write_regs(char *ptr, char* output) {
+static void handle_write_regs(gdb_ctx_t *ctx, char *ptr, char* output) {
     assert(*ptr++ == 'G');
 
     seL4_UserContext context;
     hex2regs(&context, ptr);
-    int error = seL4_TCB_WriteRegisters(target_thread->tcb, true, 0,
-                                        sizeof(seL4_UserContext) / sizeof(seL4_Word), &context);
+    int error = STATS_INVOKE(&ctx->stats, statsInvocation_write_registers,
+                             seL4_TCB_WriteRegisters(ctx->session->target_thread->tcb, true, 0,
+                                                     sizeof(seL4_UserContext) / sizeof(seL4_Word), &context));
     strlcpy(output, "OK", BUFSIZE);
 }
 
-// @alwin: Make this safe
+/* Write a thread-id of the form p<pid>.<tid> into the len bytes at ptr, and return where it ends. A
+   thread-id needs at most THREAD_ID_LEN bytes, including the NUL terminator. */
+#define THREAD_ID_LEN 12
 static char *write_thread_id(gdb_thread_t *thread, char *ptr, int len) {
-    *(ptr++) = 'p';
-    ptr = mem2hex((char *) &thread->inferior->gdb_id, ptr, sizeof(uint8_t));
-    *(ptr++) = '.';
-    return mem2hex((char *) &thread->gdb_id, ptr, sizeof(uint8_t));
+    if (len <= 0) {
+        return ptr;
+    }
+
+    int n = snprintf(ptr, len, "p%x.%x", thread->inferior->gdb_id, thread->gdb_id);
+    return ptr + ((n < len) ? n : len - 1);
 }
 
-static void handle_query(char *ptr, char *output) {
+static void handle_temporary_breakpoint(gdb_ctx_t *ctx, char *ptr, char *output);
+static void report_stop(gdb_ctx_t *ctx, gdb_thread_t *thread, char *output);
+static bool report_lifecycle_event(gdb_ctx_t *ctx);
+
+/* Reply to qfThreadInfo/qsThreadInfo with as many threads as fit in a packet, carrying on from
+   where the last one left off */
+static void handle_thread_info(gdb_ctx_t *ctx, char *output) {
+    char *out_ptr = output;
+    *out_ptr++ = 'm';
+    for (; ctx->session->thread_info_inferior_idx < MAX_PDS; ctx->session->thread_info_inferior_idx++, ctx->session->thread_info_thread_idx = 0) {
+        gdb_inferior_t *inferior = &ctx->inferiors[ctx->session->thread_info_inferior_idx];
+        if (!in_session(ctx, inferior)) continue;
+
+        for (; ctx->session->thread_info_thread_idx < MAX_THREADS; ctx->session->thread_info_thread_idx++) {
+            if (!inferior->threads[ctx->session->thread_info_thread_idx].enabled) continue;
+            if (out_ptr - output > BUFSIZE - THREAD_ID_LEN - 2) {
+                return;
+            }
+
+            if (out_ptr - output > 1) {
+                *out_ptr++ = ',';
+            }
+            out_ptr = write_thread_id(&inferior->threads[ctx->session->thread_info_thread_idx], out_ptr,
+                                      BUFSIZE - (out_ptr - output));
+        }
+    }
+
+    if (out_ptr - output == 1) {
+        strlcpy(output, "l", BUFSIZE);
+    }
+}
+
+/* Copy the part of text that falls within [offset, offset + len) of the document being transferred.
+   pos is where text starts in the document. */
+static void xfer_append(const char *text, seL4_Word *pos, seL4_Word offset, seL4_Word len, char **out) {
+    for (; *text; text++, (*pos)++) {
+        if (*pos >= offset && *pos < offset + len) {
+            *(*out)++ = *text;
+        }
+    }
+}
+
+/* qXfer:threads:read::offset,length. The thread list is generated as it is read rather than being
+   kept around, as there can be a lot of threads. */
+static void handle_xfer_threads(gdb_ctx_t *ctx, char *ptr, char *output) {
+    seL4_Word offset = 0, len = 0;
+    ptr = hexstr_to_int(ptr, sizeof(seL4_Word) * 2, &offset);
+    if (*ptr++ != ',') {
+        strlcpy(output, "E01", BUFSIZE);
+        return;
+    }
+    hexstr_to_int(ptr, sizeof(seL4_Word) * 2, &len);
+    if (len > BUFSIZE - 2) {
+        len = BUFSIZE - 2;
+    }
+
+    char entry[THREAD_ID_LEN + 24];
+    char *out_ptr = output + 1;
+    seL4_Word pos = 0;
+    xfer_append("<?xml version=\"1.0\"?>\n<threads>\n", &pos, offset, len, &out_ptr);
+    for (int i = 0; i < MAX_PDS && pos < offset + len; i++) {
+        if (!in_session(ctx, &ctx->inferiors[i])) continue;
+        for (int j = 0; j < MAX_THREADS && pos < offset + len; j++) {
+            gdb_thread_t *thread = &ctx->inferiors[i].threads[j];
+            if (!thread->enabled) continue;
+
+            char *entry_ptr = entry + snprintf(entry, sizeof(entry), "<thread id=\"");
+            entry_ptr = write_thread_id(thread, entry_ptr, sizeof(entry) - (entry_ptr - entry));
+            strlcpy(entry_ptr, "\"/>\n", sizeof(entry) - (entry_ptr - entry));
+            xfer_append(entry, &pos, offset, len, &out_ptr);
+        }
+    }
+    xfer_append("</threads>\n", &pos, offset, len, &out_ptr);
+    *out_ptr = 0;
+
+    /* 'l' marks the last part of the document */
+    output[0] = (pos <= offset + len) ? 'l' : 'm';
+    ctx->session->lifecycle_event_reported = false;
+}
+
+static void handle_query(gdb_ctx_t *ctx, char *ptr, char *output) {
     if (strncmp(ptr, "qSupported", 10) == 0) {
         /* TODO: This may eventually support more features */
         snprintf(output, BUFSIZE,
-                 "qSupported:PacketSize=%lx;QThreadEvents+;swbreak+;hwbreak+;vContSupported+;fork-events+;exec-events+;multiprocess+;", BUFSIZE);
+                 "qSupported:PacketSize=%lx;QThreadEvents+;swbreak+;hwbreak+;vContSupported+;fork-events+;exec-events+;multiprocess+;BreakpointCommands+;QNonStop+;qXfer:threads:read+;", BUFSIZE);
     } else if (strncmp(ptr, "qfThreadInfo", 12) == 0) {
-        char *out_ptr = output;
-        *out_ptr++ = 'm';
-        int num_printed = 0;
-        for (int i = 0; i < MAX_PDS; i++) {
-            if (inferiors[i].enabled) {
-                for (int j = 0; j < MAX_THREADS; j++) {
-                    if (inferiors[i].threads[j].enabled) {
-                        if (num_printed > 0) {
-                            *out_ptr++ = ',';
-                        }
-                        out_ptr = write_thread_id(&inferiors[i].threads[j], out_ptr, 0);
-                        num_printed++;
-                    }
-                }
-            }
-        }
+        ctx->session->thread_info_inferior_idx = 0;
+        ctx->session->thread_info_thread_idx = 0;
+        handle_thread_info(ctx, output);
     } else if (strncmp(ptr, "qsThreadInfo", 12) == 0) {
-        strlcpy(output, "l", BUFSIZE);
+        handle_thread_info(ctx, output);
+    } else if (strncmp(ptr, "qXfer:threads:read::", 20) == 0) {
+        handle_xfer_threads(ctx, ptr + 20, output);
     } else if (strncmp(ptr, "qC", 2) == 0) {
-        strlcpy(output, "QCp1.1", BUFSIZE);
+        if (ctx->session->target_thread) {
+            strlcpy(output, "QC", BUFSIZE);
+            write_thread_id(ctx->session->target_thread, output + 2, BUFSIZE - 2);
+        } else {
+            strlcpy(output, "E01", BUFSIZE);
+        }
     } else if (strncmp(ptr, "qSymbol", 7) == 0) {
         strlcpy(output, "OK", BUFSIZE);
     } else if (strncmp(ptr, "qTStatus", 8) == 0) {
@@ -89,9 +171,22 @@ static void handle_query(char *ptr, char *output) {
     } else if (strncmp(ptr, "qAttached", 9) == 0) {
         strlcpy(output, "1", BUFSIZE);
     } else if (strncmp(ptr, "QThreadEvents:1", 15) == 0) {
+        ctx->session->thread_events = true;
         strlcpy(output, "OK", BUFSIZE);
     } else if (strncmp(ptr, "QThreadEvents:0", 15) == 0) {
+        ctx->session->thread_events = false;
+        strlcpy(output, "OK", BUFSIZE);
+    } else if (strncmp(ptr, "QNonStop:1", 10) == 0 || strncmp(ptr, "QNonStop:0", 10) == 0) {
+        ctx->session->non_stop = (ptr[9] == '1');
+        ctx->session->pending_stops_head = ctx->session->pending_stops_tail = 0;
+        ctx->session->stop_notified = false;
+        /* GDB only changes mode while every thread is stopped */
+        ctx->session->stop_reported = !ctx->session->non_stop;
         strlcpy(output, "OK", BUFSIZE);
+    } else if (strncmp(ptr, "Qsel4.TempBreak:", 16) == 0) {
+        handle_temporary_breakpoint(ctx, ptr + 16, output);
+    } else if (strncmp(ptr, "qRcmd,", 6) == 0) {
+        gdb_monitor_handle(ctx, ptr + 6, output);
     }
 }
 
@@ -125,12 +220,13 @@ static bool parse_mem_format(char *ptr, seL4_Word *addr, seL4_Word *size)
     }
 }
 
-static bool parse_breakpoint_format(char *ptr, seL4_Word *addr, seL4_Word *kind)
+static bool parse_breakpoint_format(char *ptr, seL4_Word *addr, seL4_Word *kind, char **extra)
 {
     /* Parse the first three characters */
     assert (*ptr == 'Z' || *ptr == 'z');
     ptr++;
     assert (*ptr >= '0' && *ptr <= '4');
+    bool is_watchpoint = (*ptr >= '2');
     ptr++;
     assert(*ptr++ == ',');
 
@@ -145,40 +241,367 @@ static bool parse_breakpoint_format(char *ptr, seL4_Word *addr, seL4_Word *kind)
     }
 
     /* This is generally to do with the size of the breakpoint that is set. This will be 4
-       for breakpoints and any of the following for watchpoints */
+       for breakpoints and the length of the watched range for watchpoints */
     ptr = hexstr_to_int(ptr, sizeof(seL4_Word) * 2, kind);
-    if (*kind != 1 && *kind != 2 && *kind != 4 && *kind != 8) {
+    *extra = ptr;
+    if (is_watchpoint) {
+        return (*kind != 0);
+    }
+
+    return (*kind == 1 || *kind == 2 || *kind == 4 || *kind == 8);
+}
+
+
+/* Find where the target-side commands for the breakpoint at addr are kept */
+static struct breakpoint_commands **lookup_breakpoint_commands(gdb_inferior_t *inferior, seL4_Word addr,
+                                                               bool hardware) {
+    if (hardware) {
+        for (int i = 0; i < seL4_NumExclusiveBreakpoints; i++) {
+            if (inferior->hardware_breakpoints[i].addr == addr) {
+                return &inferior->hardware_breakpoints[i].commands;
+            }
+        }
+    } else {
+        for (int i = 0; i < MAX_SW_BREAKS; i++) {
+            if (inferior->software_breakpoints[i].addr == addr) {
+                return &inferior->software_breakpoints[i].commands;
+            }
+        }
+    }
+
+    return NULL;
+}
+
+/* Find the hit counters for the breakpoint at addr. These outlive the breakpoint being removed. */
+static bp_counters_t *lookup_breakpoint_counters(gdb_inferior_t *inferior, seL4_Word addr, bool hardware) {
+    if (hardware) {
+        for (int i = 0; i < seL4_NumExclusiveBreakpoints; i++) {
+            if (inferior->hardware_breakpoints[i].counters.addr == addr) {
+                return &inferior->hardware_breakpoints[i].counters;
+            }
+        }
+    } else {
+        for (int i = 0; i < MAX_SW_BREAKS; i++) {
+            if (inferior->software_breakpoints[i].counters.addr == addr) {
+                return &inferior->software_breakpoints[i].counters;
+            }
+        }
+    }
+
+    return NULL;
+}
+
+/* Hand any ignore count set with "monitor ignore" before the breakpoint was inserted to its counters */
+static void take_pending_ignore(gdb_inferior_t *inferior, bp_counters_t *counters) {
+    for (int i = 0; i < MAX_PENDING_IGNORES; i++) {
+        bp_counters_t *pending = &inferior->pending_ignores[i];
+        if (pending->addr == counters->addr) {
+            counters->ignore_count = pending->ignore_count;
+            pending->addr = 0;
+            return;
+        }
+    }
+}
+
+/* Choose a free slot for a breakpoint at address. A slot that last held a breakpoint at the same
+   address is preferred so that its counters carry over, then one that has never been used. */
+int free_sw_breakpoint_slot(gdb_inferior_t *inferior, seL4_Word address) {
+    int slot = -1;
+    for (int i = 0; i < MAX_SW_BREAKS; i++) {
+        sw_break_t *bp = &inferior->software_breakpoints[i];
+        if (bp->addr != 0) continue;
+        if (bp->counters.addr == address) {
+            slot = i;
+            break;
+        }
+        if (slot < 0 || (bp->counters.addr == 0 && inferior->software_breakpoints[slot].counters.addr != 0)) {
+            slot = i;
+        }
+    }
+
+    if (slot >= 0) {
+        bp_counters_t *counters = &inferior->software_breakpoints[slot].counters;
+        if (counters->addr != address) {
+            *counters = (bp_counters_t) {.addr = address};
+        }
+        take_pending_ignore(inferior, counters);
+    }
+    return slot;
+}
+
+int free_hw_breakpoint_slot(gdb_inferior_t *inferior, seL4_Word address) {
+    int slot = -1;
+    for (int i = 0; i < seL4_NumExclusiveBreakpoints; i++) {
+        hw_break_t *bp = &inferior->hardware_breakpoints[i];
+        if (bp->addr != 0) continue;
+        if (bp->counters.addr == address) {
+            slot = i;
+            break;
+        }
+        if (slot < 0 || (bp->counters.addr == 0 && inferior->hardware_breakpoints[slot].counters.addr != 0)) {
+            slot = i;
+        }
+    }
+
+    if (slot >= 0) {
+        bp_counters_t *counters = &inferior->hardware_breakpoints[slot].counters;
+        if (counters->addr != address) {
+            *counters = (bp_counters_t) {.addr = address};
+        }
+        take_pending_ignore(inferior, counters);
+    }
+    return slot;
+}
+
+static bool print_breakpoint_counters(gdb_ctx_t *ctx, gdb_inferior_t *inferior, bp_counters_t *counters,
+                                      bool inserted, bool hardware) {
+    if (!counters->addr) return false;
+    gdb_monitor_printf(ctx, "p%x 0x%lx %s hits=%u ignore=%u%s\n", inferior->gdb_id, counters->addr,
+                       hardware ? "hw" : "sw", counters->hits, counters->ignore_count, inserted ? "" : " (removed)");
+    return true;
+}
+
+/* "monitor hits": list the target-side hit counters of every breakpoint */
+static int monitor_hits(gdb_ctx_t *ctx, char *args, void *cookie) {
+    bool reset = (strncmp(args, "reset", 5) == 0);
+    bool printed = false;
+    for (int i = 0; i < MAX_PDS; i++) {
+        gdb_inferior_t *inferior = &ctx->inferiors[i];
+        if (!in_session(ctx, inferior)) continue;
+
+        for (int j = 0; j < MAX_SW_BREAKS; j++) {
+            sw_break_t *bp = &inferior->software_breakpoints[j];
+            if (reset) {
+                bp->counters.hits = 0;
+            } else {
+                printed |= print_breakpoint_counters(ctx, inferior, &bp->counters, bp->addr != 0, false);
+            }
+        }
+        for (int j = 0; j < seL4_NumExclusiveBreakpoints; j++) {
+            hw_break_t *bp = &inferior->hardware_breakpoints[j];
+            if (reset) {
+                bp->counters.hits = 0;
+            } else {
+                printed |= print_breakpoint_counters(ctx, inferior, &bp->counters, bp->addr != 0, true);
+            }
+        }
+    }
+
+    if (!printed) {
+        gdb_monitor_printf(ctx, reset ? "Hit counters reset\n" : "No breakpoints\n");
+    }
+    return 0;
+}
+
+/* "monitor ignore <addr> <count>": resume without reporting the next <count> hits of the breakpoint
+   at <addr> in the current inferior. The breakpoint does not need to be inserted yet. */
+static int monitor_ignore(gdb_ctx_t *ctx, char *args, void *cookie) {
+    seL4_Word addr = 0, count = 0;
+    if (strncmp(args, "0x", 2) == 0) {
+        args += 2;
+    }
+    args = hexstr_to_int(args, sizeof(seL4_Word) * 2, &addr);
+    if (*args++ != ' ' || addr == 0) {
+        return -1;
+    }
+    args = decstr_to_int(args, &count);
+    if (*args != 0) {
+        return -1;
+    }
+
+    if (ctx->session->target_thread == NULL) {
+        return -1;
+    }
+    gdb_inferior_t *inferior = ctx->session->target_thread->inferior;
+
+    bp_counters_t *counters = NULL;
+    for (int i = 0; i < MAX_SW_BREAKS && !counters; i++) {
+        if (inferior->software_breakpoints[i].addr == addr) {
+            counters = &inferior->software_breakpoints[i].counters;
+        }
+    }
+    for (int i = 0; i < seL4_NumExclusiveBreakpoints && !counters; i++) {
+        if (inferior->hardware_breakpoints[i].addr == addr) {
+            counters = &inferior->hardware_breakpoints[i].counters;
+        }
+    }
+    /* Not inserted yet, so keep the count until a software or hardware breakpoint is */
+    for (int i = 0; i < MAX_PENDING_IGNORES && !counters; i++) {
+        if (inferior->pending_ignores[i].addr == addr) {
+            counters = &inferior->pending_ignores[i];
+        }
+    }
+    for (int i = 0; i < MAX_PENDING_IGNORES && !counters; i++) {
+        if (inferior->pending_ignores[i].addr == 0) {
+            counters = &inferior->pending_ignores[i];
+            counters->addr = addr;
+        }
+    }
+    if (!counters) {
+        return -1;
+    }
+
+    counters->ignore_count = count;
+    gdb_monitor_printf(ctx, "Will ignore next %lu hits of breakpoint at 0x%lx\n", count, addr);
+    return 0;
+}
+
+/*
+ * Temporary breakpoints are inserted with the vendor packet Qsel4.TempBreak:<addr>[:<sp>]. They are
+ * the target-side equivalent of the breakpoints GDB inserts for finish/until/advance, except that
+ * nothing needs to be inserted or removed when the system stops and resumes. Like GDB's breakpoint
+ * for finish, one with a stack pointer only stops the thread once it is back in that frame. If GDB
+ * already has a breakpoint at the address, that one is used instead.
+ */
+static bool set_temporary_breakpoint(gdb_inferior_t *inferior, seL4_Word addr, seL4_Word sp) {
+    for (int i = 0; i < MAX_SW_BREAKS; i++) {
+        if (inferior->software_breakpoints[i].addr == addr) {
+            return true;
+        }
+    }
+
+    if (!set_software_breakpoint(inferior, addr)) {
         return false;
     }
 
+    for (int i = 0; i < MAX_SW_BREAKS; i++) {
+        if (inferior->software_breakpoints[i].addr == addr) {
+            inferior->software_breakpoints[i].temporary = true;
+            inferior->software_breakpoints[i].temporary_sp = sp;
+        }
+    }
     return true;
 }
 
+static sw_break_t *lookup_temporary_breakpoint(gdb_inferior_t *inferior, seL4_Word addr) {
+    for (int i = 0; i < MAX_SW_BREAKS; i++) {
+        sw_break_t *bp = &inferior->software_breakpoints[i];
+        if (bp->temporary && bp->addr == addr) {
+            return bp;
+        }
+    }
+
+    return NULL;
+}
+
+/* Take out the temporary breakpoints of an inferior. If remove is false, only the temporary
+   breakpoint at addr is handed over to GDB instead. */
+static void clear_temporary_breakpoints(gdb_inferior_t *inferior, seL4_Word addr, bool remove) {
+    for (int i = 0; i < MAX_SW_BREAKS; i++) {
+        sw_break_t *bp = &inferior->software_breakpoints[i];
+        if (!bp->temporary) continue;
+
+        if (remove) {
+            bp->temporary = false;
+            unset_software_breakpoint(inferior, bp->addr);
+        } else if (bp->addr == addr) {
+            bp->temporary = false;
+        }
+    }
+}
+
+/* Qsel4.TempBreak:<addr>[:<sp>][,<addr>[:<sp>]...] inserts temporary breakpoints in the current inferior */
+static void handle_temporary_breakpoint(gdb_ctx_t *ctx, char *ptr, char *output) {
+    if (ctx->session->target_thread == NULL) {
+        strlcpy(output, "E01", BUFSIZE);
+        return;
+    }
 
-static void handle_configure_debug_events(char *ptr, char *output) {
+    do {
+        seL4_Word addr = 0, sp = 0;
+        ptr = hexstr_to_int(ptr, sizeof(seL4_Word) * 2, &addr);
+        if (*ptr == ':') {
+            ptr = hexstr_to_int(ptr + 1, sizeof(seL4_Word) * 2, &sp);
+        }
+        if ((*ptr != 0 && *ptr != ',') || !set_temporary_breakpoint(ctx->session->target_thread->inferior, addr, sp)) {
+            strlcpy(output, "E01", BUFSIZE);
+            return;
+        }
+    } while (*ptr++ == ',');
+
+    strlcpy(output, "OK", BUFSIZE);
+}
+
+static void clear_breakpoint_commands(gdb_inferior_t *inferior, seL4_Word addr, bool hardware) {
+    struct breakpoint_commands **commands = lookup_breakpoint_commands(inferior, addr, hardware);
+    if (commands) {
+        bp_commands_free(*commands);
+        *commands = NULL;
+    }
+}
+
+/* Parse the optional ";cond_list;cmds:..." part of a Z0/Z1 packet. Conditions are skipped as we
+   don't advertise ConditionalBreakpoints. */
+static bool parse_breakpoint_extras(gdb_ctx_t *ctx, char *ptr, bp_commands_t **commands) {
+    *commands = NULL;
+    while (*ptr == ';') {
+        ptr++;
+        if (strncmp(ptr, "cmds:", 5) == 0) {
+            bp_commands_free(*commands);
+            *commands = bp_commands_alloc(ctx);
+            if (!*commands || !parse_breakpoint_commands(ptr, *commands)) {
+                bp_commands_free(*commands);
+                *commands = NULL;
+                return false;
+            }
+        }
+
+        while (*ptr && *ptr != ';') {
+            ptr++;
+        }
+    }
+
+    return true;
+}
+
+static void handle_configure_debug_events(gdb_ctx_t *ctx, char *ptr, char *output) {
     /* Precondition: ptr[0] is always 'z' or 'Z' */
     seL4_Word addr, size;
+    char *extra;
     bool success = false;
 
-    if (!parse_breakpoint_format(ptr, &addr, &size)) {
+    if (!parse_breakpoint_format(ptr, &addr, &size, &extra)) {
         strlcpy(output, "E01", BUFSIZE);
         return;
     }
 
     /* Breakpoints and watchpoints */
 
-    if (strncmp(ptr, "Z0", 2) == 0) {
-        /* Set a software breakpoint using binary rewriting */
-        success = set_software_breakpoint(target_thread->inferior, addr);
+    if (strncmp(ptr, "Z0", 2) == 0 || strncmp(ptr, "Z1", 2) == 0) {
+        bool hardware = (ptr[1] == '1');
+        bp_commands_t *commands;
+        if (!parse_breakpoint_extras(ctx, extra, &commands)) {
+            strlcpy(output, "E01", BUFSIZE);
+            return;
+        }
+
+        if (hardware) {
+            /* Set a hardware breakpoint */
+            success = set_hardware_breakpoint(ctx->session->target_thread->inferior, addr);
+        } else {
+            /* Set a software breakpoint using binary rewriting */
+            success = set_software_breakpoint(ctx->session->target_thread->inferior, addr);
+        }
+
+        /* GDB sends the full set of commands each time the breakpoint is inserted */
+        if (success) {
+            if (!hardware) {
+                /* GDB's breakpoint takes over from a temporary one at the same address */
+                clear_temporary_breakpoints(ctx->session->target_thread->inferior, addr, false);
+            }
+            clear_breakpoint_commands(ctx->session->target_thread->inferior, addr, hardware);
+            *lookup_breakpoint_commands(ctx->session->target_thread->inferior, addr, hardware) = commands;
+        } else {
+            bp_commands_free(commands);
+        }
     } else if (strncmp(ptr, "z0", 2) == 0) {
         /* Unset a software breakpoint */
-        success = unset_software_breakpoint(target_thread->inferior, addr);
-    } else if (strncmp(ptr, "Z1", 2) == 0) {
-        /* Set a hardware breakpoint */
-        success = set_hardware_breakpoint(target_thread->inferior, addr);
+        clear_breakpoint_commands(ctx->session->target_thread->inferior, addr, false);
+        success = unset_software_breakpoint(ctx->session->target_thread->inferior, addr);
     } else if (strncmp(ptr, "z1", 2) == 0) {
         /* Unset a hardware breakpoint */
-        success = unset_hardware_breakpoint(target_thread->inferior, addr);
+        clear_breakpoint_commands(ctx->session->target_thread->inferior, addr, true);
+        success = unset_hardware_breakpoint(ctx->session->target_thread->inferior, addr);
     } else {
         seL4_BreakpointAccess watchpoint_type;
         switch (ptr[1]) {
@@ -197,9 +620,9 @@ static void handle_configure_debug_events(char *ptr, char *output) {
         }
 
         if (ptr[0] == 'Z') {
-            success = set_hardware_watchpoint(target_thread->inferior, addr, watchpoint_type, size);
+            success = set_hardware_watchpoint(ctx->session->target_thread->inferior, addr, watchpoint_type, size);
         } else {
-            success = unset_hardware_watchpoint(target_thread->inferior, addr, watchpoint_type, size);
+            success = unset_hardware_watchpoint(ctx->session->target_thread->inferior, addr, watchpoint_type, size);
         }
     }
 
@@ -210,11 +633,11 @@ static void handle_configure_debug_events(char *ptr, char *output) {
     }
 }
 
-static gdb_inferior_t *lookup_inferior_from_id(uint64_t inferior_id) {
+static gdb_inferior_t *lookup_inferior_from_id(gdb_ctx_t *ctx, uint64_t inferior_id) {
     // @alwin: This should really be implemented with a hashmap
     for (int i = 0; i < MAX_PDS; i++) {
-        if (inferiors[i].enabled && inferiors[i].id == inferior_id) {
-            return &inferiors[i];
+        if (ctx->inferiors[i].enabled && ctx->inferiors[i].id == inferior_id) {
+            return &ctx->inferiors[i];
         }
     }
 
@@ -232,11 +655,77 @@ static gdb_thread_t *lookup_thread_from_id(gdb_inferior_t *inferior, uint64_t th
     return NULL;
 }
 
+static void select_session(gdb_ctx_t *ctx, int idx) {
+    ctx->session_idx = idx;
+    ctx->session = &ctx->sessions[idx];
+}
+
+/* A thread for the selected session to look at when it doesn't have one */
+static gdb_thread_t *first_session_thread(gdb_ctx_t *ctx) {
+    for (int i = 0; i < MAX_PDS; i++) {
+        if (!in_session(ctx, &ctx->inferiors[i])) continue;
+        for (int j = 0; j < MAX_THREADS; j++) {
+            if (ctx->inferiors[i].threads[j].enabled) {
+                return &ctx->inferiors[i].threads[j];
+            }
+        }
+    }
+
+    return NULL;
+}
+
+void gdb_ctx_init(gdb_ctx_t *ctx) {
+    memset(ctx, 0, sizeof(gdb_ctx_t));
+    gdb_stats_reset(&ctx->stats);
+    select_session(ctx, 0);
+
+    gdb_register_monitor_command(ctx, "hits", "hits [reset]", monitor_hits, NULL);
+    gdb_register_monitor_command(ctx, "ignore", "ignore <addr> <count>", monitor_ignore, NULL);
+    gdb_register_monitor_command(ctx, "stats", "stats [reset|invocations|<packet>]", gdb_stats_monitor,
+                                 &ctx->stats);
+}
+
+void gdb_select_session(gdb_ctx_t *ctx, int idx) {
+    assert(idx >= 0 && idx < MAX_SESSIONS);
+    select_session(ctx, idx);
+}
+
+int gdb_selected_session(gdb_ctx_t *ctx) {
+    return ctx->session_idx;
+}
 
+DebuggerError gdb_assign_inferior(gdb_ctx_t *ctx, uint64_t inferior_id, int idx) {
+    if (idx < 0 || idx >= MAX_SESSIONS) {
+        return DebuggerError_InvalidArguments;
+    }
 
-DebuggerError gdb_register_inferior(uint64_t inferior_id, seL4_CPtr vspace) {
+    gdb_inferior_t *inferior = lookup_inferior_from_id(ctx, inferior_id);
+    if (!inferior) {
+        return DebuggerError_InvalidArguments;
+    }
+
+    int prev_idx = ctx->session_idx;
+
+    /* The session it is leaving may have been looking at one of its threads */
+    select_session(ctx, inferior->session);
+    if (ctx->session->target_thread && ctx->session->target_thread->inferior == inferior) {
+        inferior->session = idx;
+        ctx->session->target_thread = first_session_thread(ctx);
+    }
+
+    inferior->session = idx;
+    select_session(ctx, idx);
+    if (!ctx->session->target_thread) {
+        ctx->session->target_thread = first_session_thread(ctx);
+    }
+
+    select_session(ctx, prev_idx);
+    return DebuggerError_NoError;
+}
+
+DebuggerError gdb_register_inferior(gdb_ctx_t *ctx, uint64_t inferior_id, seL4_CPtr vspace) {
     /* Check that an inferior with this ID doesn't already exist */
-    gdb_inferior_t *inferior = lookup_inferior_from_id(inferior_id);
+    gdb_inferior_t *inferior = lookup_inferior_from_id(ctx, inferior_id);
     if (inferior) {
         if (inferior->vspace == vspace) {
             return DebuggerError_AlreadyRegistered;
@@ -245,23 +734,27 @@ DebuggerError gdb_register_inferior(uint64_t inferior_id, seL4_CPtr vspace) {
         }
     }
 
-    int end_idx = curr_inferior_idx + MAX_PDS;
+    int end_idx = ctx->curr_inferior_idx + MAX_PDS;
 
     /* Find a free slot to put this inferior */
-    for (; curr_inferior_idx < end_idx; curr_inferior_idx++) {
-        if (inferiors[curr_inferior_idx % MAX_PDS].enabled) {
+    for (; ctx->curr_inferior_idx < end_idx; ctx->curr_inferior_idx++) {
+        if (ctx->inferiors[ctx->curr_inferior_idx % MAX_PDS].enabled) {
             continue;
         }
 
-        inferior = &inferiors[curr_inferior_idx % MAX_PDS];
+        inferior = &ctx->inferiors[ctx->curr_inferior_idx % MAX_PDS];
         inferior->enabled = true;
         inferior->id = inferior_id;
-        inferior->gdb_id = ++curr_inferior_idx;
+        inferior->gdb_id = ++ctx->curr_inferior_idx;
         inferior->vspace = vspace;
+        inferior->session = 0;
+        inferior->stats = &ctx->stats;
+        inferior->watchpoint_mask_unsupported = false;
         inferior->curr_thread_idx = 0;
         memset(inferior->threads, 0, MAX_THREADS * sizeof(gdb_thread_t));
         memset(inferior->software_breakpoints, 0, MAX_SW_BREAKS * sizeof(sw_break_t));
         memset(inferior->hardware_breakpoints, 0, seL4_NumExclusiveBreakpoints * sizeof(hw_break_t));
+        memset(inferior->pending_ignores, 0, MAX_PENDING_IGNORES * sizeof(bp_counters_t));
         memset(inferior->hardware_watchpoints, 0, seL4_NumExclusiveWatchpoints * sizeof(hw_watch_t));
         return DebuggerError_NoError;
     }
@@ -269,13 +762,17 @@ DebuggerError gdb_register_inferior(uint64_t inferior_id, seL4_CPtr vspace) {
     return DebuggerError_InsufficientResources;
 }
 
-DebuggerError gdb_register_thread(uint64_t inferior_id, uint64_t thread_id, seL4_CPtr tcb, char *output) {
+DebuggerError gdb_register_thread(gdb_ctx_t *ctx, uint64_t inferior_id, uint64_t thread_id, seL4_CPtr tcb, char *output) {
+    output[0] = 0;
+
     /* Make sure the inferior exists */
-    gdb_inferior_t *inferior = lookup_inferior_from_id(inferior_id);
+    gdb_inferior_t *inferior = lookup_inferior_from_id(ctx, inferior_id);
     if (!inferior) {
         return DebuggerError_InvalidArguments;
     }
 
+    select_session(ctx, inferior->session);
+
     /* Check that a thread with this ID doesn't already exist */
     gdb_thread_t *thread = lookup_thread_from_id(inferior, thread_id);
     if (thread) {
@@ -297,6 +794,10 @@ DebuggerError gdb_register_thread(uint64_t inferior_id, uint64_t thread_id, seL4
         thread->enabled = true;
         thread->wakeup = false;
         thread->ss_enabled = false;
+        thread->step_over_addr = 0;
+        thread->range_start = thread->range_end = 0;
+        thread->stopped = false;
+        thread->stop_signal = 0;
         thread->inferior = inferior;
         thread->id = thread_id;
         thread->gdb_id = ++inferior->curr_thread_idx;
@@ -314,14 +815,13 @@ DebuggerError gdb_register_thread(uint64_t inferior_id, uint64_t thread_id, seL4
             thread_enable_nth_hw_watchpoint(thread, i);
         }
 
-        if (!target_thread) {
-            target_thread = thread;
-        } else {
-            strlcpy(output, "T05clone:", BUFSIZE);
+        if (!ctx->session->target_thread) {
+            ctx->session->target_thread = thread;
+        } else if (report_lifecycle_event(ctx)) {
+            strlcpy(output, "T05create:;thread:", BUFSIZE);
             char *ptr = write_thread_id(thread, output + strnlen(output, BUFSIZE), BUFSIZE - strnlen(output, BUFSIZE));
-            strlcpy(ptr, ";thread:", BUFSIZE);
-            ptr = write_thread_id(target_thread, output + strnlen(output, BUFSIZE), BUFSIZE - strnlen(output, BUFSIZE));
             strlcpy(ptr, ";", BUFSIZE);
+            report_stop(ctx, thread, output);
         }
 
         return DebuggerError_NoError;
@@ -330,7 +830,7 @@ DebuggerError gdb_register_thread(uint64_t inferior_id, uint64_t thread_id, seL4
     return DebuggerError_InsufficientResources;
 }
 
-static void handle_read_mem(char *ptr, char *output) {
+static void handle_read_mem(gdb_ctx_t *ctx, char *ptr, char *output) {
     seL4_Word addr, size, error;
 
     if (!parse_mem_format(ptr, &addr, &size)) {
@@ -340,14 +840,14 @@ static void handle_read_mem(char *ptr, char *output) {
         /* Buffer too small? Don't really get this */
         strlcpy(output, "E01", BUFSIZE);
     } else {
-        if (inf_mem2hex(target_thread, addr, output, size, &error) == NULL) {
+        if (inf_mem2hex(ctx->session->target_thread, addr, output, size, &error) == NULL) {
             /* Failed to read the memory at the location */
            strlcpy(output, "E04", BUFSIZE);
         }
     }
 }
 
-static void handle_write_mem(char *ptr, char *output) {
+static void handle_write_mem(gdb_ctx_t *ctx, char *ptr, char *output) {
     seL4_Word addr, size;
 
     if (!parse_mem_format(ptr, &addr, &size)) {
@@ -355,7 +855,7 @@ static void handle_write_mem(char *ptr, char *output) {
     } else {
         if ((ptr = memchr(ptr, ':', BUFSIZE))) {
             ptr++;
-            if (inf_hex2mem(target_thread, ptr, addr, size) == 0) {
+            if (inf_hex2mem(ctx->session->target_thread, ptr, addr, size) == 0) {
                 strlcpy(output, "E03", BUFSIZE);
             } else {
                 strlcpy(output, "OK", BUFSIZE);
@@ -364,58 +864,38 @@ static void handle_write_mem(char *ptr, char *output) {
     }
 }
 
-static char *parse_thread_id(char *ptr, int *proc_id, int* thread_id) {
-    int size = 0;
-    if (*ptr++ != 'p') {
-        return NULL;
-    }
-
-    char *ptr_tmp = ptr;
-    if (strncmp(ptr, "-1", 3) == 0) {
-        *proc_id = -1;
+/* Parse one half of a thread-id, which is either a hex number or -1 */
+static char *parse_id(char *ptr, int *id) {
+    if (ptr[0] == '-' && ptr[1] == '1') {
+        *id = -1;
         return ptr + 2;
     }
 
-    while (*ptr_tmp++ != '.') {
-        size++;
-    }
-
-    /* 2 hex chars per byte */
-    size /= 2;
-
-    if (size == 0) {
-        *proc_id = hexchar_to_int(*ptr);
-    } else {
-        hex2mem(ptr, (char *) proc_id, size);
-    }
-
-    ptr = ptr_tmp;
-    size = 0;
-    if (strncmp(ptr, "-1", 3) == 0) {
-        *thread_id = -1;
-        return ptr + 2;
-    }
+    seL4_Word val = 0;
+    char *end = hexstr_to_int(ptr, sizeof(seL4_Word) * 2, &val);
+    *id = val;
+    return end;
+}
 
-    while (hexchar_to_int(*ptr_tmp++) != -1) {
-        size++;
+/* Parse a thread-id of the form p<pid>.<tid>. A thread-id without the tid means all of the threads
+   in the process. Returns the first character after the thread-id. */
+static char *parse_thread_id(char *ptr, int *proc_id, int* thread_id) {
+    if (*ptr++ != 'p') {
+        return NULL;
     }
 
-    /* 2 hex chars per byte */
-    size /= 2;
-
-    if (size == 0) {
-        *thread_id = hexchar_to_int(*ptr);
-    } else {
-        hex2mem(ptr, (char *) thread_id, size);
+    ptr = parse_id(ptr, proc_id);
+    if (*ptr != '.') {
+        *thread_id = THREAD_ID_ALL;
+        return ptr;
     }
 
-    // Return the last character that was not a hexchar
-    return ptr_tmp - 1;
+    return parse_id(ptr + 1, thread_id);
 }
 
-static gdb_thread_t *lookup_thread_from_gdb_id(int proc_id, int thread_id) {
-    gdb_inferior_t *inferior = &inferiors[GDB_INFERIOR_ID_TO_IDX(proc_id)];
-    if (inferior->gdb_id != proc_id) {
+static gdb_thread_t *lookup_thread_from_gdb_id(gdb_ctx_t *ctx, int proc_id, int thread_id) {
+    gdb_inferior_t *inferior = &ctx->inferiors[GDB_INFERIOR_ID_TO_IDX(proc_id)];
+    if (inferior->gdb_id != proc_id || !in_session(ctx, inferior)) {
         return NULL;
     }
 
@@ -427,16 +907,16 @@ static gdb_thread_t *lookup_thread_from_gdb_id(int proc_id, int thread_id) {
     return thread;
 }
 
-static gdb_inferior_t *lookup_inferior_from_gdb_id(int proc_id) {
-    gdb_inferior_t *inferior = &inferiors[(proc_id - 1) % MAX_PDS];
-    if (inferior->gdb_id != proc_id) {
+static gdb_inferior_t *lookup_inferior_from_gdb_id(gdb_ctx_t *ctx, int proc_id) {
+    gdb_inferior_t *inferior = &ctx->inferiors[(proc_id - 1) % MAX_PDS];
+    if (inferior->gdb_id != proc_id || !in_session(ctx, inferior)) {
         return NULL;
     }
 
     return inferior;
 }
 
-static void handle_check_thread_alive(char *ptr, char *output) {
+static void handle_check_thread_alive(gdb_ctx_t *ctx, char *ptr, char *output) {
     assert(*ptr++ == 'T');
 
     int proc_id, thread_id = 0;
@@ -445,15 +925,17 @@ static void handle_check_thread_alive(char *ptr, char *output) {
         return;
     }
 
-    gdb_thread_t *thread = lookup_thread_from_gdb_id(proc_id, thread_id);
-    if (thread->gdb_id == thread_id && thread->enabled == true) {
+    gdb_thread_t *thread = lookup_thread_from_gdb_id(ctx, proc_id, thread_id);
+    if (thread && thread->enabled == true) {
         strlcpy(output, "OK", BUFSIZE);
+    } else {
+        strlcpy(output, "E01", BUFSIZE);
     }
 
     return;
 }
 
-static void handle_set_inferior(char *ptr, char *output) {
+static void handle_set_inferior(gdb_ctx_t *ctx, char *ptr, char *output) {
     int proc_id, thread_id = 0;
 
     assert(*ptr++ = 'H');
@@ -465,7 +947,7 @@ static void handle_set_inferior(char *ptr, char *output) {
     ptr++;
 
     if (*ptr == '-' && *(ptr + 1) == '1') {
-        assert(target_thread != NULL);
+        assert(ctx->session->target_thread != NULL);
         strlcpy(output, "OK", BUFSIZE);
         return;
     } else if (parse_thread_id(ptr, &proc_id, &thread_id) == NULL) {
@@ -476,20 +958,21 @@ static void handle_set_inferior(char *ptr, char *output) {
 
     assert(proc_id != PROC_ID_ALL);
     if (proc_id != PROC_ID_ANY) {
-        gdb_inferior_t *inferior = lookup_inferior_from_gdb_id(proc_id);
+        gdb_inferior_t *inferior = lookup_inferior_from_gdb_id(ctx, proc_id);
         if (!inferior) {
             strlcpy(output, "E02", BUFSIZE);
             return;
         }
 
         if (thread_id != THREAD_ID_ALL) {
-            if (thread_id == THREAD_ID_ANY) {
-                // @alwin: Is this the behaviour we want? I don't think so
-                // because thread 1 could be dead
-                target_thread = lookup_thread_from_gdb_id(proc_id, 1);
-            } else {
-                target_thread = lookup_thread_from_gdb_id(proc_id, thread_id);
+            // @alwin: Is this the behaviour we want for THREAD_ID_ANY? I don't think so
+            // because thread 1 could be dead
+            gdb_thread_t *thread = lookup_thread_from_gdb_id(ctx, proc_id, (thread_id == THREAD_ID_ANY) ? 1 : thread_id);
+            if (!thread) {
+                strlcpy(output, "E02", BUFSIZE);
+                return;
             }
+            ctx->session->target_thread = thread;
         } else {
             // @alwin: Figure out what to do when thread_id == THREAD_ID_ALL
         }
@@ -498,118 +981,287 @@ static void handle_set_inferior(char *ptr, char *output) {
         // For now, we just leave the current thread as the target thread, which seems fairly valid
     }
 
-    assert(target_thread->enabled && target_thread->tcb != 0);
+    assert(ctx->session->target_thread->enabled && ctx->session->target_thread->tcb != 0);
     strlcpy(output, "OK", BUFSIZE);
 }
 
-void handle_sig_interrupt(char *output) {
+void handle_sig_interrupt(gdb_ctx_t *ctx, char *output) {
     strlcpy(output, "S02", BUFSIZE);
+    ctx->session->stop_reported = true;
+}
+
+/* Queue a stop reply to be reported to GDB later */
+static void queue_stop_reply(gdb_ctx_t *ctx, gdb_thread_t *thread, char *reply) {
+    thread->stop_signal = (reply[0] == 'T') ? (hexchar_to_int(reply[1]) << 4) | hexchar_to_int(reply[2]) : 0;
+
+    /* Each thread has at most one stop queued as it stays suspended until GDB resumes it, so
+       this can only fill up with a very large number of threads. GDB can still find out about
+       dropped stops with '?'. */
+    if (ctx->session->pending_stops_tail - ctx->session->pending_stops_head == MAX_PENDING_STOPS) {
+        return;
+    }
+    ctx->session->pending_stop_threads[ctx->session->pending_stops_tail % MAX_PENDING_STOPS] = thread;
+    strlcpy(ctx->session->pending_stops[ctx->session->pending_stops_tail++ % MAX_PENDING_STOPS], reply, STOP_REPLY_SIZE);
 }
 
-bool handled[MAX_PDS][MAX_THREADS] = {0};
+/* In all-stop mode, take the next stop that happened while GDB was looking at an earlier one */
+static bool report_pending_stop(gdb_ctx_t *ctx, char *output) {
+    while (ctx->session->pending_stops_head != ctx->session->pending_stops_tail) {
+        gdb_thread_t *thread = ctx->session->pending_stop_threads[ctx->session->pending_stops_head % MAX_PENDING_STOPS];
+        char *reply = ctx->session->pending_stops[ctx->session->pending_stops_head++ % MAX_PENDING_STOPS];
+        if (reply[0] == 'T') {
+            /* The thread may have exited in the meantime */
+            if (!thread->enabled) continue;
+            /* As we include a thread-id, GDB expects the target inferior to be the thread that we set */
+            ctx->session->target_thread = thread;
+        }
 
+        strlcpy(output, reply, BUFSIZE);
+        return true;
+    }
 
-void handle_vcont(char *input, char *output) {
+    return false;
+}
+
+/* Suspend a single thread and mark it as stopped, as opposed to suspend_system(ctx) */
+static void stop_thread(gdb_thread_t *thread) {
+    if (!thread->stopped) {
+        STATS_INVOKE(thread->inferior->stats, statsInvocation_suspend, seL4_TCB_Suspend(thread->tcb));
+    }
+    thread->stopped = true;
+    thread->wakeup = false;
+}
+
+/* Deal with a stop reply for thread that is about to be sent to GDB. In non-stop mode it becomes a
+   notification, and in all-stop mode it is queued if GDB has not finished with the last stop. output
+   is left empty if there is nothing to send right now. */
+static void report_stop(gdb_ctx_t *ctx, gdb_thread_t *thread, char *output) {
+    if (ctx->session->non_stop || ctx->session->stop_reported) {
+        /* The thread stays stopped until GDB has been told about it and resumes it */
+        if (thread->enabled) {
+            stop_thread(thread);
+        }
+        queue_stop_reply(ctx, thread, output);
+        if (!gdb_stop_notification(ctx, output)) {
+            output[0] = 0;
+        }
+    } else {
+        ctx->session->stop_reported = true;
+        if (output[0] == 'T') {
+            /* As we include a thread-id, GDB expects the target inferior to be the thread that we set */
+            ctx->session->target_thread = thread;
+        }
+    }
+}
+
+/* Whether a thread creation or exit should be reported to GDB rather than coalesced */
+static bool report_lifecycle_event(gdb_ctx_t *ctx) {
+    if (!ctx->session->thread_events || ctx->session->lifecycle_event_reported) {
+        return false;
+    }
+
+    ctx->session->lifecycle_event_reported = true;
+    return true;
+}
+
+static void write_stop_reply(gdb_thread_t *thread, uint8_t signal, char *output) {
+    char *ptr = output;
+    *ptr++ = 'T';
+    ptr = mem2hex((char *) &signal, ptr, sizeof(uint8_t));
+    strlcpy(ptr, "thread:", BUFSIZE - (ptr - output));
+    ptr += strnlen(ptr, BUFSIZE - (ptr - output));
+    ptr = write_thread_id(thread, ptr, BUFSIZE - (ptr - output));
+    strlcpy(ptr, ";", BUFSIZE - (ptr - output));
+}
+
+bool gdb_stop_notification(gdb_ctx_t *ctx, char *output) {
+    output[0] = 0;
+    if (!ctx->session->non_stop || ctx->session->stop_notified || ctx->session->pending_stops_head == ctx->session->pending_stops_tail) {
+        return false;
+    }
+
+    ctx->session->stop_notified = true;
+    snprintf(output, BUFSIZE, "%%Stop:%s", ctx->session->pending_stops[ctx->session->pending_stops_head % MAX_PENDING_STOPS]);
+    return true;
+}
+
+/* GDB acknowledges a stop notification with vStopped, and we reply with the next queued stop until
+   there are none left */
+static void handle_vstopped(gdb_ctx_t *ctx, char *output) {
+    if (ctx->session->pending_stops_head != ctx->session->pending_stops_tail) {
+        ctx->session->pending_stops_head++;
+    }
+
+    if (ctx->session->pending_stops_head != ctx->session->pending_stops_tail) {
+        strlcpy(output, ctx->session->pending_stops[ctx->session->pending_stops_head % MAX_PENDING_STOPS], BUFSIZE);
+    } else {
+        ctx->session->stop_notified = false;
+        strlcpy(output, "OK", BUFSIZE);
+    }
+}
+
+/* In non-stop mode, '?' restarts the reporting of every stopped thread, which GDB then drains
+   with vStopped */
+static void handle_stop_status_non_stop(gdb_ctx_t *ctx, char *output) {
+    char reply[STOP_REPLY_SIZE];
+    ctx->session->pending_stops_head = ctx->session->pending_stops_tail = 0;
+    for (int i = 0; i < MAX_PDS; i++) {
+        if (!in_session(ctx, &ctx->inferiors[i])) continue;
+        for (int j = 0; j < MAX_THREADS; j++) {
+            gdb_thread_t *thread = &ctx->inferiors[i].threads[j];
+            if (!thread->enabled || !thread->stopped) continue;
+            write_stop_reply(thread, thread->stop_signal, reply);
+            queue_stop_reply(ctx, thread, reply);
+        }
+    }
+
+    if (ctx->session->pending_stops_head != ctx->session->pending_stops_tail) {
+        ctx->session->stop_notified = true;
+        strlcpy(output, ctx->session->pending_stops[ctx->session->pending_stops_head % MAX_PENDING_STOPS], BUFSIZE);
+    } else {
+        ctx->session->stop_notified = false;
+        strlcpy(output, "OK", BUFSIZE);
+    }
+}
+
+/* Turn single-stepping on or off, only asking the kernel when the state actually changes */
+static void set_single_step(gdb_thread_t *thread, bool enable) {
+    if (thread->step_over_addr) {
+        /* Stepping has to stay on until the thread is past the breakpoint, and end_step_over
+           then leaves it on or turns it off according to ss_enabled */
+        thread->ss_enabled = enable;
+    } else if (enable && !thread->ss_enabled) {
+        enable_single_step(thread);
+    } else if (!enable && thread->ss_enabled) {
+        disable_single_step(thread);
+    }
+}
+
+/* Apply a single vCont action to a thread */
+static void vcont_apply(gdb_ctx_t *ctx, gdb_thread_t *thread, char action, seL4_Word range_start, seL4_Word range_end) {
+    if (action == 't') {
+        /* A thread stopped by GDB reports a stop with signal 0 */
+        if (!thread->stopped) {
+            char reply[STOP_REPLY_SIZE];
+            stop_thread(thread);
+            write_stop_reply(thread, 0, reply);
+            queue_stop_reply(ctx, thread, reply);
+        }
+        return;
+    }
+
+    set_single_step(thread, action == 's' || action == 'S' || action == 'r');
+    thread->range_start = range_start;
+    thread->range_end = range_end;
+    thread->wakeup = true;
+}
+
+/*
+ * Each action applies to the threads it names that an action further left in the packet has not
+ * already claimed. Threads that no action applies to are left stopped, so with scheduler-locking
+ * only the thread being stepped is resumed.
+ */
+void handle_vcont(gdb_ctx_t *ctx, char *input, char *output) {
     /* Skip the original vcont prefix */
     input += 5;
 
-    memset(handled, 0, MAX_PDS * MAX_THREADS * sizeof(bool));
+    memset(ctx->handled, 0, sizeof(ctx->handled));
+
+    for (int i = 0; i < MAX_PDS; i++) {
+        if (!in_session(ctx, &ctx->inferiors[i])) continue;
+        for (int j = 0; j < MAX_THREADS; j++) {
+            ctx->inferiors[i].threads[j].wakeup = false;
+        }
+    }
 
     while (*input != 0) {
-        assert(*input++ == ';');
-
-        bool stepping;
-        if (*input == 's') {
-            /* If we are stepping, only the thing being stepped should continue*/
-            stepping = true;
-            for (int i = 0; i < MAX_PDS; i++) {
-                if (!inferiors[i].enabled) continue;
-                for (int j = 0; j < MAX_THREADS; j++) {
-                    if (!inferiors[i].threads[j].enabled) continue;
-                    inferiors[i].threads[j].wakeup = false;
-                }
-            }
-        } else if (*input == 'c') {
-            stepping = false;
-            // @alwin: I think this is a bit dodgy. not entirely convinced that this will
-            // work when there are both step and continue things in the same package
-            for (int i = 0; i < MAX_PDS; i++) {
-                if (!inferiors[i].enabled) continue;
-                for (int j = 0; j < MAX_THREADS; j++) {
-                    if (!inferiors[i].threads[j].enabled) continue;
-                    inferiors[i].threads[j].wakeup = true;
-                }
-            }
-        } else {
-            /* @alwin: For now only deal with stepping and continuing */
+        if (*input++ != ';') {
             strlcpy(output, "E04", BUFSIZE);
             return;
         }
-        input++;
-
-        do {
-            assert(*input++ == ':');
-            int proc_id, thread_id;
-            input = parse_thread_id(input, &proc_id, &thread_id);
 
-            if (proc_id == PROC_ID_ALL) {
-                // @alwin: In this case, we should select all inferiors.
-                printf("TODO: proc_id=-1 provided in vCont packet");
-                continue;
+        char action = *input++;
+        seL4_Word signal = 0, range_start = 0, range_end = 0;
+        if (action == 'C' || action == 'S') {
+            /* We don't deliver signals, so these behave like 'c' and 's' */
+            input = hexstr_to_int(input, 2, &signal);
+        } else if (action == 'r') {
+            /* Range stepping is a step that keeps going while the pc is in [start, end) */
+            input = hexstr_to_int(input, sizeof(seL4_Word) * 2, &range_start);
+            if (*input++ != ',') {
+                strlcpy(output, "E04", BUFSIZE);
+                return;
             }
+            input = hexstr_to_int(input, sizeof(seL4_Word) * 2, &range_end);
+        } else if (action != 'c' && action != 's' && !(action == 't' && ctx->session->non_stop)) {
+            strlcpy(output, "E04", BUFSIZE);
+            return;
+        }
 
-            gdb_inferior_t *inferior = lookup_inferior_from_gdb_id(proc_id);
-
-            /* If thread_id == -1, we want to apply the action to all the threads in the inferior  */
-            int i = 0;
-            int n = MAX_THREADS;
-            if (thread_id != THREAD_ID_ALL) {
-                i = GDB_THREAD_ID_TO_IDX(thread_id);
-                n = thread_id;
+        /* An action without a thread-id applies to every thread */
+        int proc_id = PROC_ID_ALL, thread_id = THREAD_ID_ALL;
+        if (*input == ':') {
+            input = parse_thread_id(input + 1, &proc_id, &thread_id);
+            if (input == NULL) {
+                strlcpy(output, "E04", BUFSIZE);
+                return;
             }
+        }
 
-            for (; i < n; i++) {
-                if (!inferior->threads[i].enabled) {
-                    continue;
-                }
-
-                if (handled[GDB_INFERIOR_ID_TO_IDX(proc_id)][i]) {
+        for (int i = 0; i < MAX_PDS; i++) {
+            gdb_inferior_t *inferior = &ctx->inferiors[i];
+            if (!in_session(ctx, inferior)) continue;
+            if (proc_id != PROC_ID_ALL && proc_id != PROC_ID_ANY && inferior->gdb_id != proc_id) continue;
+
+            for (int j = 0; j < MAX_THREADS; j++) {
+                gdb_thread_t *thread = &inferior->threads[j];
+                if (!thread->enabled || ctx->handled[i][j]) continue;
+                if (thread_id != THREAD_ID_ALL && thread_id != THREAD_ID_ANY && thread->gdb_id != thread_id) {
                     continue;
                 }
 
-                if (stepping) {
-                    enable_single_step(&inferior->threads[i]);
-                } else {
-                    disable_single_step(&inferior->threads[i]);
-                }
-
-                handled[GDB_INFERIOR_ID_TO_IDX(proc_id)][i] = true;
-                inferior->threads[i].wakeup = true;
+                ctx->handled[i][j] = true;
+                vcont_apply(ctx, thread, action, range_start, range_end);
             }
-        } while (*input == ':');
+        }
+    }
+
+    /* In non-stop mode vCont is acknowledged straight away and stops are reported later */
+    if (ctx->session->non_stop) {
+        strlcpy(output, "OK", BUFSIZE);
     }
 }
 
-static void handle_detach(char *ptr, char *output) {
+static void handle_detach(gdb_ctx_t *ctx, char *ptr, char *output) {
     /* @alwin: This packet could also be used to detach a single specific process */
     strlcpy(output, "OK", BUFSIZE);
 
+    /* The next GDB to connect starts off in all-stop mode */
+    ctx->session->non_stop = false;
+    ctx->session->pending_stops_head = ctx->session->pending_stops_tail = 0;
+    ctx->session->stop_notified = false;
+    ctx->session->stop_reported = false;
+    ctx->session->thread_events = false;
+    ctx->session->lifecycle_event_reported = false;
+
     for (int i = 0; i < MAX_PDS; i++) {
-        if (!inferiors[i].enabled) continue;
+        if (!in_session(ctx, &ctx->inferiors[i])) continue;
 
-        gdb_inferior_t *inferior = &inferiors[i];
+        gdb_inferior_t *inferior = &ctx->inferiors[i];
 
         /* Clear any breakpoints/watchpoints */
         for (int i = 0; i < MAX_SW_BREAKS; i++) {
+            bp_commands_free(inferior->software_breakpoints[i].commands);
             unset_software_breakpoint(inferior, inferior->software_breakpoints[i].addr);
         }
         for (int i = 0; i < seL4_NumExclusiveBreakpoints; i++) {
+            bp_commands_free(inferior->hardware_breakpoints[i].commands);
             unset_hardware_breakpoint(inferior, inferior->hardware_breakpoints[i].addr);
         }
         for (int i = 0; i < seL4_NumExclusiveWatchpoints; i++) {
-            unset_hardware_watchpoint(inferior, inferior->hardware_watchpoints[i].addr,
+            unset_hardware_watchpoint(inferior, inferior->hardware_watchpoints[i].range_addr,
                                       inferior->hardware_watchpoints[i].type,
-                                      inferior->hardware_watchpoints[i].size);
+                                      inferior->hardware_watchpoints[i].range_size);
         }
         memset(inferior->software_breakpoints, 0, MAX_SW_BREAKS * sizeof(sw_break_t));
         memset(inferior->hardware_breakpoints, 0, seL4_NumExclusiveBreakpoints * sizeof(hw_break_t));
@@ -630,51 +1282,73 @@ static void handle_detach(char *ptr, char *output) {
     return;
 }
 
-bool gdb_handle_packet(char *input, char *output, bool *detached) {
+static bool handle_packet(gdb_ctx_t *ctx, char *input, char *output, bool *detached) {
     output[0] = 0;
     if (*input == 'g') {
-        handle_read_regs(output);
+        handle_read_regs(ctx, output);
     } else if (*input == 'G') {
-        handle_write_regs(input, output);
+        handle_write_regs(ctx, input, output);
     } else if (*input == 'm') {
-        handle_read_mem(input, output);
+        handle_read_mem(ctx, input, output);
     } else if (*input == 'M') {
-        handle_write_mem(input, output);
+        handle_write_mem(ctx, input, output);
     } else if (*input == 'q' || *input == 'Q') {
-        handle_query(input, output);
+        handle_query(ctx, input, output);
     } else if (*input == 'H') {
-        handle_set_inferior(input, output);
+        handle_set_inferior(ctx, input, output);
     } else if (*input == 'D') {
-        handle_detach(input, output);
+        handle_detach(ctx, input, output);
         *detached = true;
         return true;
     } else if (*input == 'T') {
-        handle_check_thread_alive(input, output);
+        handle_check_thread_alive(ctx, input, output);
     } else if (*input == '?') {
         /* @alwin: This should probably report reasons other than swbreak, though I've only seen
          * this packet be used when first connecting to the system, in which case only swbreak makes
          * any sense.
          */
-        strlcpy(output, "T05swbreak:;", BUFSIZE);
+        if (ctx->session->non_stop) {
+            handle_stop_status_non_stop(ctx, output);
+        } else {
+            strlcpy(output, "T05swbreak:;", BUFSIZE);
+            ctx->session->stop_reported = true;
+        }
     } else if (*input == 'v') {
         if (strncmp(input, "vCont?", 7) == 0) {
-            strlcpy(output, "vCont;c;C;s;S", BUFSIZE);
+            strlcpy(output, "vCont;c;C;s;S;t;r", BUFSIZE);
+        } else if (strncmp(input, "vStopped", 8) == 0) {
+            handle_vstopped(ctx, output);
         } else if (strncmp(input, "vCont;", 6) == 0) {
+            /* A stop that happened while GDB was looking at the last one is reported straight away
+               instead of resuming anything */
+            if (!ctx->session->non_stop && report_pending_stop(ctx, output)) {
+                return false;
+            }
+
             /* vCont is a substitute for s and c when doing multiprocess stuff */
-            handle_vcont(input, output);
+            handle_vcont(ctx, input, output);
+            ctx->session->stop_reported = false;
+            ctx->session->lifecycle_event_reported = false;
             return true;
         }
     } else if (*input == 'z' || *input == 'Z') {
-        handle_configure_debug_events(input, output);
+        handle_configure_debug_events(ctx, input, output);
     } else if (*input == 3) {
         /* In case the ctrl-C character was entered */
-        handle_sig_interrupt(output);
+        handle_sig_interrupt(ctx, output);
     }
 
     return false;
 }
 
-static void handle_ss_hwbreak_swbreak_exception(gdb_thread_t *thread, seL4_Word reason, char *output) {
+bool gdb_handle_packet(gdb_ctx_t *ctx, char *input, char *output, bool *detached) {
+    gdb_stats_begin(&ctx->stats, input);
+    bool resume = handle_packet(ctx, input, output, detached);
+    gdb_stats_end(&ctx->stats, output);
+    return resume;
+}
+
+static void handle_ss_hwbreak_swbreak_exception(gdb_ctx_t *ctx, gdb_thread_t *thread, seL4_Word reason, char *output) {
     strlcpy(output, "T05thread:", BUFSIZE);
     char *ptr = write_thread_id(thread, output + strnlen(output, BUFSIZE), BUFSIZE - strnlen(output, BUFSIZE));
     if (reason == seL4_SoftwareBreakRequest) {
@@ -684,10 +1358,10 @@ static void handle_ss_hwbreak_swbreak_exception(gdb_thread_t *thread, seL4_Word
     }
 
     /* As we include a thread-id, GDB expects the target inferior to be the thread that we set */
-    target_thread = thread;
+    ctx->session->target_thread = thread;
 }
 
-static void handle_watchpoint_exception(gdb_thread_t *thread, seL4_Word bp_num, seL4_Word trigger_address, char *output) {
+static void handle_watchpoint_exception(gdb_ctx_t *ctx, gdb_thread_t *thread, seL4_Word bp_num, seL4_Word trigger_address, char *output) {
 
     strlcpy(output, "T05thread:", BUFSIZE);
     char *ptr = write_thread_id(thread, output + strnlen(output, BUFSIZE), BUFSIZE - strnlen(output, BUFSIZE));
@@ -710,10 +1384,10 @@ static void handle_watchpoint_exception(gdb_thread_t *thread, seL4_Word bp_num,
     strlcpy(ptr, ";", BUFSIZE);
 
     /* As we include a thread-id, GDB expects the target inferior to be the thread that we set */
-    target_thread = thread;
+    ctx->session->target_thread = thread;
 }
 
-static bool handle_debug_exception(gdb_thread_t *thread, seL4_Word *reply_mr, char *output) {
+static bool handle_debug_exception(gdb_ctx_t *ctx, gdb_thread_t *thread, seL4_Word *reply_mr, char *output) {
 #ifndef MICROKIT
     seL4_Word reason = seL4_GetMR(seL4_DebugException_ExceptionReason);
     seL4_Word fault_ip = seL4_GetMR(seL4_DebugException_FaultIP);
@@ -726,13 +1400,66 @@ static bool handle_debug_exception(gdb_thread_t *thread, seL4_Word *reply_mr, ch
     seL4_Word bp_num = microkit_mr_get(seL4_DebugException_BreakpointNumber);
 #endif
     switch (reason) {
-        case seL4_InstructionBreakpoint:
         case seL4_SingleStep:
-        case seL4_SoftwareBreakRequest:
-            handle_ss_hwbreak_swbreak_exception(thread, reason, output);
+            if (thread->step_over_addr) {
+                end_step_over(thread);
+                /* The step was only taken to get past a breakpoint, so GDB doesn't need to know */
+                if (!thread->ss_enabled) {
+                    break;
+                }
+            }
+
+            /* Keep range stepping locally until the thread leaves the range */
+            if (fault_ip >= thread->range_start && fault_ip < thread->range_end) {
+                break;
+            }
+            thread->range_start = thread->range_end = 0;
+            handle_ss_hwbreak_swbreak_exception(ctx, thread, reason, output);
             break;
+        case seL4_InstructionBreakpoint:
+        case seL4_SoftwareBreakRequest: {
+            bool hardware = (reason == seL4_InstructionBreakpoint);
+            bool keep_going = false;
+
+            sw_break_t *temporary = hardware ? NULL : lookup_temporary_breakpoint(thread->inferior, fault_ip);
+            if (temporary) {
+                /* A hit in a deeper frame than the one the breakpoint is for doesn't count */
+                seL4_Word sp;
+                if (temporary->temporary_sp && thread_read_sp(thread, &sp) && sp < temporary->temporary_sp &&
+                    begin_step_over(thread, fault_ip)) {
+                    break;
+                }
+
+                /* GDB never inserted this breakpoint, but the stop is still reported as a software
+                   breakpoint hit rather than a stray SIGTRAP */
+                clear_temporary_breakpoints(thread->inferior, fault_ip, true);
+                handle_ss_hwbreak_swbreak_exception(ctx, thread, reason, output);
+                break;
+            }
+
+            bp_counters_t *counters = lookup_breakpoint_counters(thread->inferior, fault_ip, hardware);
+            if (counters) {
+                counters->hits++;
+            }
+
+            /* Breakpoints with target-side commands (i.e. dprintf) run them and keep going */
+            struct breakpoint_commands **commands = lookup_breakpoint_commands(thread->inferior, fault_ip, hardware);
+            if (commands && *commands) {
+                run_breakpoint_commands(ctx, thread, *commands);
+                keep_going = true;
+            } else if (counters && counters->ignore_count > 0) {
+                counters->ignore_count--;
+                keep_going = true;
+            }
+
+            if (keep_going && begin_step_over(thread, fault_ip)) {
+                break;
+            }
+            handle_ss_hwbreak_swbreak_exception(ctx, thread, reason, output);
+            break;
+        }
         case seL4_DataBreakpoint:
-            handle_watchpoint_exception(thread, bp_num, trigger_address, output);
+            handle_watchpoint_exception(ctx, thread, bp_num, trigger_address, output);
             break;
     }
 
@@ -740,7 +1467,7 @@ static bool handle_debug_exception(gdb_thread_t *thread, seL4_Word *reply_mr, ch
     return true;
 }
 
-static bool handle_fault(gdb_thread_t *thread, seL4_Word exception_reason, char *output) {
+static bool handle_fault(gdb_ctx_t *ctx, gdb_thread_t *thread, seL4_Word exception_reason, char *output) {
     // @alwin: I'm pretty sure there is no fault here that should reawaken the thread. Think about this more.
     // @alwin: Currentlywe just doing SIGABRT for every kind of fault that happens, this probably could be better?
 
@@ -749,54 +1476,69 @@ static bool handle_fault(gdb_thread_t *thread, seL4_Word exception_reason, char
     strlcpy(ptr, ";", BUFSIZE);
 
     /* As we include a thread-id, GDB expects the target inferior to be the thread that we set */
-    target_thread = thread;
+    ctx->session->target_thread = thread;
 
     return false;
 }
 
 /*
- * Suspend all threads (that GDB is aware of) in the system
+ * Suspend all threads (that GDB is aware of) in the system. In non-stop mode this does nothing, as
+ * threads are only stopped individually when they fault or GDB asks for them with vCont;t.
  */
-void suspend_system() {
+void suspend_system(gdb_ctx_t *ctx) {
+    if (ctx->session->non_stop) {
+        return;
+    }
+
     for (int i = 0; i < MAX_PDS; i++) {
-        gdb_inferior_t *inferior = &inferiors[i];
-        if (!inferior->enabled) continue;
+        gdb_inferior_t *inferior = &ctx->inferiors[i];
+        if (!in_session(ctx, inferior)) continue;
 
         for (int j = 0; j < MAX_THREADS; j++) {
             gdb_thread_t *thread = &inferior->threads[j];
-            if (!thread->enabled) continue;
+            if (!thread->enabled || thread->stopped) continue;
 
-            seL4_TCB_Suspend(thread->tcb);
+            STATS_INVOKE(&ctx->stats, statsInvocation_suspend, seL4_TCB_Suspend(thread->tcb));
+            thread->stopped = true;
         }
     }
 }
 
 /*
- * Resume the threads in the system that are meant to be woken up
+ * Resume the threads in the system that are meant to be woken up. Threads that are already running
+ * are left alone.
  */
-void resume_system() {
+void resume_system(gdb_ctx_t *ctx) {
    for (int i = 0; i < MAX_PDS; i++) {
-        gdb_inferior_t *inferior = &inferiors[i];
-        if (!inferior->enabled) continue;
+        gdb_inferior_t *inferior = &ctx->inferiors[i];
+        if (!in_session(ctx, inferior)) continue;
 
         for (int j = 0; j < MAX_THREADS; j++) {
             gdb_thread_t *thread = &inferior->threads[j];
-            if (!thread->enabled || !thread->wakeup) continue;
+            if (!thread->enabled || !thread->wakeup || !thread->stopped) continue;
 
-            seL4_TCB_Resume(thread->tcb);
+            STATS_INVOKE(&ctx->stats, statsInvocation_resume, seL4_TCB_Resume(thread->tcb));
+            thread->stopped = false;
         }
     }
 }
 
 
-DebuggerError gdb_handle_fault(uint64_t inferior_id, uint64_t thread_id, seL4_Word exception_reason,
-                      seL4_Word *reply_mr, char *output, bool *have_reply) {
+static DebuggerError handle_inferior_fault(gdb_ctx_t *ctx, uint64_t inferior_id, uint64_t thread_id,
+                                           seL4_Word exception_reason, seL4_Word *reply_mr, char *output,
+                                           bool *have_reply) {
+    output[0] = 0;
+
     /* Make sure the inferior exists */
-    gdb_inferior_t *inferior = lookup_inferior_from_id(inferior_id);
+    gdb_inferior_t *inferior = lookup_inferior_from_id(ctx, inferior_id);
     if (!inferior) {
         return DebuggerError_InvalidArguments;
     }
 
+    /* The stop is reported to the GDB debugging this inferior */
+    select_session(ctx, inferior->session);
+    gdb_thread_t *prev_target_thread = ctx->session->target_thread;
+
     /* Make sure the thread exists */
     gdb_thread_t *thread = lookup_thread_from_id(inferior, thread_id);
     if (!thread) {
@@ -804,17 +1546,67 @@ DebuggerError gdb_handle_fault(uint64_t inferior_id, uint64_t thread_id, seL4_Wo
     }
 
     if (exception_reason  == seL4_Fault_DebugException) {
-        *have_reply = handle_debug_exception(thread, reply_mr, output);
+        *have_reply = handle_debug_exception(ctx, thread, reply_mr, output);
     } else {
-        *have_reply = handle_fault(thread, exception_reason, output);
+        *have_reply = handle_fault(ctx, thread, exception_reason, output);
+    }
+
+    if (output[0] != 0) {
+        /* Like GDB's own, temporary breakpoints don't outlive the next stop */
+        clear_temporary_breakpoints(thread->inferior, 0, true);
+
+        /* Only the stop reply itself should change the thread GDB is looking at */
+        ctx->session->target_thread = prev_target_thread;
+        report_stop(ctx, thread, output);
     }
 
     return DebuggerError_NoError;
 }
 
-DebuggerError gdb_thread_exit(uint64_t inferior_id, uint64_t thread_id, char* output) {
+DebuggerError gdb_handle_fault(gdb_ctx_t *ctx, uint64_t inferior_id, uint64_t thread_id, seL4_Word exception_reason,
+                      seL4_Word *reply_mr, char *output, bool *have_reply) {
+    gdb_stats_begin_fault(&ctx->stats);
+    DebuggerError err = handle_inferior_fault(ctx, inferior_id, thread_id, exception_reason, reply_mr, output,
+                                              have_reply);
+    gdb_stats_end(&ctx->stats, output);
+    return err;
+}
+
+void gdb_console_write(gdb_ctx_t *ctx, const char *buf, int len) {
+    for (int i = 0; i < len; i++) {
+        /* Drop output if GDB has not been around to take it */
+        if (ctx->session->console_tail - ctx->session->console_head == CONSOLE_BUFSIZE) {
+            return;
+        }
+        ctx->session->console_buf[ctx->session->console_tail++ % CONSOLE_BUFSIZE] = buf[i];
+    }
+}
+
+bool gdb_console_pending(gdb_ctx_t *ctx) {
+    /* GDB only accepts console output while the target is running in all-stop mode */
+    return !ctx->session->non_stop && ctx->session->console_head != ctx->session->console_tail;
+}
+
+bool gdb_console_drain(gdb_ctx_t *ctx, char *output) {
+    if (!gdb_console_pending(ctx)) {
+        return false;
+    }
+
+    /* Two hex characters per byte, leaving space for the 'O' and the NUL terminator */
+    char *ptr = output;
+    *ptr++ = 'O';
+    while (ctx->session->console_head != ctx->session->console_tail && ptr - output < BUFSIZE - 3) {
+        ptr = mem2hex(&ctx->session->console_buf[ctx->session->console_head++ % CONSOLE_BUFSIZE], ptr, 1);
+    }
+
+    return true;
+}
+
+DebuggerError gdb_thread_exit(gdb_ctx_t *ctx, uint64_t inferior_id, uint64_t thread_id, char* output) {
+    output[0] = 0;
+
     /* Make sure the inferior exists */
-    gdb_inferior_t *inferior = lookup_inferior_from_id(inferior_id);
+    gdb_inferior_t *inferior = lookup_inferior_from_id(ctx, inferior_id);
     if (!inferior) {
         return DebuggerError_InvalidArguments;
     }
@@ -825,9 +1617,16 @@ DebuggerError gdb_thread_exit(uint64_t inferior_id, uint64_t thread_id, char* ou
         return DebuggerError_InvalidArguments;
     }
 
+    select_session(ctx, inferior->session);
     thread->enabled = false;
-    strlcpy(output, "w00;", BUFSIZE);
-    char *ptr = write_thread_id(thread, output + strnlen(output, BUFSIZE), BUFSIZE - strnlen(output, BUFSIZE));
+    if (ctx->session->target_thread == thread) {
+        ctx->session->target_thread = first_session_thread(ctx);
+    }
+    if (report_lifecycle_event(ctx)) {
+        strlcpy(output, "w00;", BUFSIZE);
+        write_thread_id(thread, output + strnlen(output, BUFSIZE), BUFSIZE - strnlen(output, BUFSIZE));
+        report_stop(ctx, thread, output);
+    }
     return DebuggerError_NoError;
 }
 
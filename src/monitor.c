@@ -0,0 +1,139 @@
+/*
+ * Copyright 2025, UNSW
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <gdb.h>
+#include <monitor.h>
+#include <util.h>
+#include <printf.h>
+#include <string.h>
+
+/* Two hex characters per byte, leaving space for the 'O' and the NUL terminator */
+#define MONITOR_CHUNK ((BUFSIZE - 2) / 2)
+
+static monitor_command_t *lookup_command(gdb_ctx_t *ctx, const char *name, int len) {
+    for (int i = 0; i < ctx->num_monitor_commands; i++) {
+        monitor_command_t *command = &ctx->monitor_commands[i];
+        if (strnlen(command->name, len + 1) == len && strncmp(command->name, name, len) == 0) {
+            return command;
+        }
+    }
+    return NULL;
+}
+
+DebuggerError gdb_register_monitor_command(gdb_ctx_t *ctx, const char *name, const char *help,
+                                           gdb_monitor_fn_t fn, void *cookie) {
+    if (name == NULL || name[0] == 0 || fn == NULL) {
+        return DebuggerError_InvalidArguments;
+    }
+    if (lookup_command(ctx, name, strnlen(name, BUFSIZE))) {
+        return DebuggerError_AlreadyRegistered;
+    }
+    if (ctx->num_monitor_commands == MAX_MONITOR_COMMANDS) {
+        return DebuggerError_InsufficientResources;
+    }
+
+    monitor_command_t *command = &ctx->monitor_commands[ctx->num_monitor_commands++];
+    command->name = name;
+    command->help = (help != NULL) ? help : name;
+    command->fn = fn;
+    command->cookie = cookie;
+    return DebuggerError_NoError;
+}
+
+void gdb_monitor_write(gdb_ctx_t *ctx, const char *buf, int len) {
+    monitor_output_t *out = &ctx->session->monitor;
+    uint32_t n = (len < MONITOR_BUFSIZE - out->len) ? len : MONITOR_BUFSIZE - out->len;
+    memcpy(out->buf + out->len, buf, n);
+    out->len += n;
+}
+
+int gdb_monitor_printf(gdb_ctx_t *ctx, const char *format, ...) {
+    monitor_output_t *out = &ctx->session->monitor;
+    uint32_t space = MONITOR_BUFSIZE - out->len;
+    if (space == 0) {
+        return 0;
+    }
+
+    va_list va;
+    va_start(va, format);
+    int n = vsnprintf(out->buf + out->len, space, format, va);
+    va_end(va);
+
+    /* Anything that didn't fit has been cut off, leaving space for the NUL terminator */
+    if (n > 0) {
+        out->len += (n < space) ? n : space - 1;
+    }
+    return n;
+}
+
+static void monitor_help(gdb_ctx_t *ctx) {
+    gdb_monitor_printf(ctx, "Supported commands:\n");
+    for (int i = 0; i < ctx->num_monitor_commands; i++) {
+        gdb_monitor_printf(ctx, "  %s\n", ctx->monitor_commands[i].help);
+    }
+}
+
+void gdb_monitor_handle(gdb_ctx_t *ctx, char *ptr, char *output) {
+    monitor_output_t *out = &ctx->session->monitor;
+    out->len = 0;
+    out->sent = 0;
+    out->pending = true;
+    out->failed = false;
+
+    char cmd[BUFSIZE / 2];
+    int cmd_len = strnlen(ptr, BUFSIZE) / 2;
+    if (cmd_len >= sizeof(cmd)) {
+        out->failed = true;
+        gdb_monitor_drain(ctx, output);
+        return;
+    }
+    hex2mem(ptr, cmd, cmd_len);
+    cmd[cmd_len] = 0;
+
+    int name_len = 0;
+    while (cmd[name_len] != 0 && cmd[name_len] != ' ') {
+        name_len++;
+    }
+    char *args = cmd + name_len + (cmd[name_len] == ' ');
+
+    /* A registered "help" takes the place of the built-in one */
+    monitor_command_t *command = lookup_command(ctx, cmd, name_len);
+    if (command) {
+        out->failed = (command->fn(ctx, args, command->cookie) < 0);
+    } else if (name_len == 0 || (name_len == 4 && strncmp(cmd, "help", 4) == 0)) {
+        monitor_help(ctx);
+    } else {
+        gdb_monitor_printf(ctx, "Unknown command \"%.*s\". ", name_len, cmd);
+        monitor_help(ctx);
+    }
+
+    gdb_monitor_drain(ctx, output);
+}
+
+bool gdb_monitor_drain(gdb_ctx_t *ctx, char *output) {
+    monitor_output_t *out = &ctx->session->monitor;
+    if (!out->pending) {
+        return false;
+    }
+
+    uint32_t left = out->len - out->sent;
+    if (left > MONITOR_CHUNK || (left > 0 && out->failed)) {
+        output[0] = 'O';
+        uint32_t n = (left < MONITOR_CHUNK) ? left : MONITOR_CHUNK;
+        mem2hex(out->buf + out->sent, output + 1, n);
+        out->sent += n;
+    } else if (left > 0) {
+        /* GDB takes a reply of just hex encoded output as the last of it, which saves sending an
+           'O' packet and then OK when the output fits in one packet */
+        mem2hex(out->buf + out->sent, output, left);
+        out->sent += left;
+        out->pending = false;
+    } else {
+        strlcpy(output, out->failed ? "E01" : "OK", BUFSIZE);
+        out->pending = false;
+    }
+    return true;
+}
@@ -0,0 +1,105 @@
+/*
+ * Copyright 2025, UNSW
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <recorder.h>
+#include <util.h>
+#include <string.h>
+
+typedef struct record_header {
+    uint64_t timestamp;
+    uint16_t len;
+    char direction;
+    uint8_t session;
+} record_header_t;
+
+static void ring_write(gdb_recorder_t *rec, uint64_t offset, const void *data, uint32_t len) {
+    uint32_t start = offset % rec->size;
+    uint32_t first = (len < rec->size - start) ? len : rec->size - start;
+    memcpy(rec->buf + start, data, first);
+    memcpy(rec->buf, (const char *) data + first, len - first);
+}
+
+static void ring_read(gdb_recorder_t *rec, uint64_t offset, void *data, uint32_t len) {
+    uint32_t start = offset % rec->size;
+    uint32_t first = (len < rec->size - start) ? len : rec->size - start;
+    memcpy(data, rec->buf + start, first);
+    memcpy((char *) data + first, rec->buf, len - first);
+}
+
+void gdb_recorder_init(gdb_recorder_t *rec, char *buf, uint32_t size) {
+    rec->buf = buf;
+    rec->size = size;
+    rec->head = rec->tail = 0;
+    rec->dropped = 0;
+}
+
+void gdb_recorder_log(gdb_recorder_t *rec, char direction, int session, const char *payload, uint32_t len) {
+    record_header_t header = {
+        .timestamp = read_cycle_counter(),
+        .len = len,
+        .direction = direction,
+        .session = session,
+    };
+
+    uint32_t needed = sizeof(header) + len;
+    if (len > UINT16_MAX || needed > rec->size) {
+        rec->dropped++;
+        return;
+    }
+
+    /* Make space by dropping the oldest records */
+    while (rec->size - (rec->tail - rec->head) < needed) {
+        record_header_t oldest;
+        ring_read(rec, rec->head, &oldest, sizeof(oldest));
+        rec->head += sizeof(oldest) + oldest.len;
+        rec->dropped++;
+    }
+
+    ring_write(rec, rec->tail, &header, sizeof(header));
+    ring_write(rec, rec->tail + sizeof(header), payload, len);
+    rec->tail += needed;
+}
+
+/* Hex encode a 64-bit value, most significant digit first */
+static char *word2hex(uint64_t value, char *buf) {
+    for (int shift = 60; shift >= 0; shift -= 4) {
+        *buf++ = int_to_hexchar((value >> shift) & 0xf);
+    }
+    return buf;
+}
+
+void gdb_recorder_dump(gdb_recorder_t *rec, void (*out)(void *cookie, const char *buf, uint32_t len),
+                       void *cookie) {
+    /* Payloads are converted a chunk at a time, so they don't need a buffer as big as a packet */
+    char line[128];
+    char chunk[(sizeof(line) - 1) / 2];
+
+    for (uint64_t offset = rec->head; offset < rec->tail;) {
+        record_header_t header;
+        ring_read(rec, offset, &header, sizeof(header));
+        offset += sizeof(header);
+
+        char *ptr = line;
+        *ptr++ = header.direction;
+        *ptr++ = ' ';
+        *ptr++ = int_to_hexchar(header.session);
+        *ptr++ = ' ';
+        ptr = word2hex(header.timestamp, ptr);
+        *ptr++ = ' ';
+        out(cookie, line, ptr - line);
+
+        for (uint32_t done = 0; done < header.len;) {
+            uint32_t n = (header.len - done < sizeof(chunk)) ? header.len - done : sizeof(chunk);
+            ring_read(rec, offset + done, chunk, n);
+            ptr = mem2hex(chunk, line, n);
+            out(cookie, line, ptr - line);
+            done += n;
+        }
+        offset += header.len;
+
+        out(cookie, "\n", 1);
+    }
+}
@@ -0,0 +1,148 @@
+/*
+ * Copyright 2025, UNSW
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <gdb.h>
+#include <stats.h>
+#include <printf.h>
+#include <string.h>
+
+static const char *packet_names[statsPacket_count] = {
+    [statsPacket_read_regs] = "g",
+    [statsPacket_write_regs] = "G",
+    [statsPacket_read_mem] = "m",
+    [statsPacket_write_mem] = "M",
+    [statsPacket_query] = "q",
+    [statsPacket_set_thread] = "H",
+    [statsPacket_thread_alive] = "T",
+    [statsPacket_stop_reason] = "?",
+    [statsPacket_vcont] = "vCont",
+    [statsPacket_v] = "v",
+    [statsPacket_insert_bp] = "Z",
+    [statsPacket_remove_bp] = "z",
+    [statsPacket_detach] = "D",
+    [statsPacket_interrupt] = "^C",
+    [statsPacket_fault] = "fault",
+    [statsPacket_other] = "other",
+};
+
+static const char *invocation_names[statsInvocation_count] = {
+    [statsInvocation_read_registers] = "TCB_ReadRegisters",
+    [statsInvocation_write_registers] = "TCB_WriteRegisters",
+    [statsInvocation_suspend] = "TCB_Suspend",
+    [statsInvocation_resume] = "TCB_Resume",
+    [statsInvocation_set_breakpoint] = "TCB_SetBreakpoint",
+    [statsInvocation_unset_breakpoint] = "TCB_UnsetBreakpoint",
+    [statsInvocation_configure_single_stepping] = "TCB_ConfigureSingleStepping",
+    [statsInvocation_vspace_read] = "ARM_VSpace_Read_Word",
+    [statsInvocation_vspace_write] = "ARM_VSpace_Write_Word",
+};
+
+static stats_packet_t classify(const char *input) {
+    switch (input[0]) {
+        case 'g': return statsPacket_read_regs;
+        case 'G': return statsPacket_write_regs;
+        case 'm': return statsPacket_read_mem;
+        case 'M': return statsPacket_write_mem;
+        case 'q':
+        case 'Q': return statsPacket_query;
+        case 'H': return statsPacket_set_thread;
+        case 'T': return statsPacket_thread_alive;
+        case '?': return statsPacket_stop_reason;
+        case 'v': return (strncmp(input, "vCont;", 6) == 0) ? statsPacket_vcont : statsPacket_v;
+        case 'Z': return statsPacket_insert_bp;
+        case 'z': return statsPacket_remove_bp;
+        case 'D': return statsPacket_detach;
+        case 3: return statsPacket_interrupt;
+        default: return statsPacket_other;
+    }
+}
+
+void gdb_stats_reset(gdb_stats_t *stats) {
+    memset(stats->packets, 0, sizeof(stats->packets));
+}
+
+static void begin(gdb_stats_t *stats, stats_packet_t packet, const char *input) {
+    stats->current = packet;
+    stats->packets[packet].bytes_in += strnlen(input, BUFSIZE);
+    stats->start = read_cycle_counter();
+}
+
+void gdb_stats_begin(gdb_stats_t *stats, const char *input) {
+    begin(stats, classify(input), input);
+}
+
+void gdb_stats_begin_fault(gdb_stats_t *stats) {
+    begin(stats, statsPacket_fault, "");
+}
+
+void gdb_stats_end(gdb_stats_t *stats, const char *output) {
+    packet_counters_t *packet = &stats->packets[stats->current];
+    packet->handled.count++;
+    packet->handled.cycles += read_cycle_counter() - stats->start;
+    packet->bytes_out += strnlen(output, BUFSIZE);
+}
+
+void gdb_stats_invoked(gdb_stats_t *stats, stats_invocation_t invocation, uint64_t cycles) {
+    stats_counter_t *counter = &stats->packets[stats->current].invocations[invocation];
+    counter->count++;
+    counter->cycles += cycles;
+}
+
+/* One line per packet type that has been seen, with the total of its kernel invocations */
+static void print_packets(struct gdb_ctx *ctx, gdb_stats_t *stats) {
+    gdb_monitor_printf(ctx, "%-6s %8s %12s %9s %9s %9s\n", "packet", "count", "cycles", "bytes in",
+                       "bytes out", "kernel");
+    for (int i = 0; i < statsPacket_count; i++) {
+        packet_counters_t *packet = &stats->packets[i];
+        if (packet->handled.count == 0) continue;
+
+        uint64_t invocations = 0;
+        for (int j = 0; j < statsInvocation_count; j++) {
+            invocations += packet->invocations[j].count;
+        }
+        gdb_monitor_printf(ctx, "%-6s %8lu %12lu %9lu %9lu %9lu\n", packet_names[i], packet->handled.count,
+                           packet->handled.cycles, packet->bytes_in, packet->bytes_out, invocations);
+    }
+}
+
+/* One line per kernel invocation, either in total or for a single packet type */
+static void print_invocations(struct gdb_ctx *ctx, gdb_stats_t *stats, int only_packet) {
+    gdb_monitor_printf(ctx, "%-28s %8s %12s\n", "invocation", "count", "cycles");
+    for (int i = 0; i < statsInvocation_count; i++) {
+        stats_counter_t total = { 0 };
+        for (int j = 0; j < statsPacket_count; j++) {
+            if (only_packet >= 0 && j != only_packet) continue;
+            total.count += stats->packets[j].invocations[i].count;
+            total.cycles += stats->packets[j].invocations[i].cycles;
+        }
+        if (total.count == 0) continue;
+
+        gdb_monitor_printf(ctx, "%-28s %8lu %12lu\n", invocation_names[i], total.count, total.cycles);
+    }
+}
+
+int gdb_stats_monitor(struct gdb_ctx *ctx, char *args, void *cookie) {
+    gdb_stats_t *stats = cookie;
+    if (args[0] == 0) {
+        print_packets(ctx, stats);
+        return 0;
+    } else if (strcmp(args, "reset") == 0) {
+        gdb_stats_reset(stats);
+        gdb_monitor_printf(ctx, "Statistics reset\n");
+        return 0;
+    } else if (strcmp(args, "invocations") == 0) {
+        print_invocations(ctx, stats, -1);
+        return 0;
+    }
+
+    for (int i = 0; i < statsPacket_count; i++) {
+        if (strcmp(args, packet_names[i]) == 0) {
+            print_invocations(ctx, stats, i);
+            return 0;
+        }
+    }
+    return -1;
+}
@@ -0,0 +1,212 @@
+/*
+ * Copyright 2025, UNSW
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+#include <transport.h>
+#include <util.h>
+#include <string.h>
+#ifndef MICROKIT
+#include <assert.h>
+#endif /* MICROKIT */
+
+static void select_session(gdb_transport_ctx_t *tctx, int session) {
+    gdb_select_session(tctx->ctx, session);
+    tctx->link = &tctx->links[session];
+}
+
+static void record(gdb_transport_ctx_t *tctx, char direction, const char *payload, uint32_t len) {
+    if (tctx->recorder != NULL) {
+        gdb_recorder_log(tctx->recorder, direction, tctx->link - tctx->links, payload, len);
+    }
+}
+
+static void transport_send(gdb_transport_ctx_t *tctx, const char *buf, uint32_t len) {
+    tctx->link->transport->send(tctx->link->transport->cookie, buf, len);
+}
+
+/*
+ * Send a packet, computing it's checksum. Unless it is a notification (which libgdb starts
+ * with a '%' and are framed with '%' instead of '$'), it is remembered until GDB acks it so
+ * that it can be resent.
+ */
+static void put_packet(gdb_transport_ctx_t *tctx, char *buf) {
+    bool is_notification = (buf[0] == '%');
+    char *payload = is_notification ? buf + 1 : buf;
+
+    uint32_t len = strnlen(payload, BUFSIZE);
+    uint8_t cksum = 0;
+    for (uint32_t i = 0; i < len; i++) {
+        cksum += payload[i];
+    }
+
+    char trailer[3] = { '#', int_to_hexchar(cksum >> 4), int_to_hexchar(cksum % 16) };
+
+    /* Notifications keep their '%' in the record, to tell them apart from packets */
+    record(tctx, RECORD_SENT, buf, len + (is_notification ? 1 : 0));
+
+    transport_send(tctx, is_notification ? "%" : "$", 1);
+    transport_send(tctx, payload, len);
+    transport_send(tctx, trailer, sizeof(trailer));
+
+    if (!is_notification) {
+        tctx->link->unacked = buf;
+    }
+}
+
+/* Send the next packet that is waiting for GDB, once the last one has been acked. The rest of a
+   monitor command's reply goes first, as GDB is waiting on it. Console output has to go out before
+   any stop reply, as GDB stops accepting it once the target has stopped. */
+static void send_pending(gdb_transport_ctx_t *tctx) {
+    if (tctx->link->unacked != NULL) {
+        return;
+    }
+
+    if (gdb_monitor_drain(tctx->ctx, tctx->link->monitor_output)) {
+        put_packet(tctx, tctx->link->monitor_output);
+    } else if (gdb_console_drain(tctx->ctx, tctx->link->console_output)) {
+        put_packet(tctx, tctx->link->console_output);
+    } else if (tctx->link->stop_reply[0] != 0) {
+        put_packet(tctx, tctx->link->stop_reply);
+        /* A %Stop notification is never acked, so it is done with as soon as it is sent. GDB asks
+           for the rest of the stops with vStopped. */
+        if (tctx->link->stop_reply[0] == '%') {
+            tctx->link->stop_reply[0] = 0;
+        }
+    }
+}
+
+static void handle_packet(gdb_transport_ctx_t *tctx, char *input) {
+    if (tctx->link->detached || input[0] == 3) {
+        /* If we got a ctrl-c packet, we should suspend the whole system */
+        suspend_system(tctx->ctx);
+        tctx->link->detached = false;
+    }
+
+    bool resume = gdb_handle_packet(tctx->ctx, input, tctx->output, &tctx->link->detached);
+
+    /* In non-stop mode, resuming packets are still acknowledged with a reply */
+    if (!resume || tctx->link->detached || tctx->output[0] != 0) {
+        put_packet(tctx, tctx->output);
+    }
+
+    if (resume) {
+        resume_system(tctx->ctx);
+    }
+
+    /* Report any threads that the packet stopped (e.g. vCont;t in non-stop mode) */
+    if (gdb_stop_notification(tctx->ctx, tctx->notification)) {
+        put_packet(tctx, tctx->notification);
+    }
+}
+
+static void handle_frame_event(gdb_transport_ctx_t *tctx, frame_event_t event) {
+    char *buf = tctx->link->framer.buf;
+
+    switch (event) {
+        case frameEvent_ack:
+            if (tctx->link->unacked == tctx->link->stop_reply) {
+                tctx->link->stop_reply[0] = 0;
+            }
+            tctx->link->unacked = NULL;
+            send_pending(tctx);
+            break;
+        case frameEvent_nack:
+            if (tctx->link->unacked != NULL) {
+                put_packet(tctx, tctx->link->unacked);
+            }
+            break;
+        case frameEvent_bad_checksum:
+            transport_send(tctx, "-", 1);
+            break;
+        case frameEvent_interrupt:
+            record(tctx, RECORD_RECEIVED, buf, 1);
+            handle_packet(tctx, buf);
+            break;
+        case frameEvent_packet:
+            record(tctx, RECORD_RECEIVED, buf, tctx->link->framer.len);
+
+            /* The ack is sent along with the reply to the packet */
+            transport_send(tctx, "+", 1);
+
+            if (buf[2] == ':') {
+                transport_send(tctx, buf, 2);
+                handle_packet(tctx, &buf[3]);
+            } else {
+                handle_packet(tctx, buf);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+void gdb_transport_ctx_init(gdb_transport_ctx_t *tctx, gdb_ctx_t *ctx) {
+    memset(tctx, 0, sizeof(gdb_transport_ctx_t));
+    tctx->ctx = ctx;
+    tctx->link = &tctx->links[0];
+}
+
+void gdb_transport_record(gdb_transport_ctx_t *tctx, gdb_recorder_t *recorder) {
+    tctx->recorder = recorder;
+}
+
+void gdb_transport_init(gdb_transport_ctx_t *tctx, int session, gdb_transport_t *transport) {
+    assert(session >= 0 && session < MAX_SESSIONS);
+    gdb_link_t *link = &tctx->links[session];
+    link->transport = transport;
+    gdb_framer_init(&link->framer);
+    link->unacked = NULL;
+    link->detached = false;
+    /* GDB asks why the target is stopped when it connects, so there is no need to tell it */
+    link->stop_reply[0] = 0;
+}
+
+void gdb_transport_poll(gdb_transport_ctx_t *tctx, int session) {
+    assert(session >= 0 && session < MAX_SESSIONS);
+    if (tctx->links[session].transport == NULL) {
+        return;
+    }
+
+    select_session(tctx, session);
+    gdb_transport_t *transport = tctx->link->transport;
+
+    uint32_t len;
+    char *data;
+    while ((data = transport->recv_peek(transport->cookie, &len)) != NULL) {
+        frame_event_t event;
+        transport->recv_consume(transport->cookie, gdb_framer_feed(&tctx->link->framer, data, len, &event));
+        handle_frame_event(tctx, event);
+    }
+
+    transport->flush(transport->cookie);
+}
+
+DebuggerError gdb_transport_fault(gdb_transport_ctx_t *tctx, uint64_t inferior_id, uint64_t thread_id,
+                                  seL4_Word exception_reason, bool *have_reply) {
+    seL4_Word reply_mr = 0;
+
+    DebuggerError err = gdb_handle_fault(tctx->ctx, inferior_id, thread_id, exception_reason, &reply_mr,
+                                         tctx->fault_output, have_reply);
+
+    /* The fault is reported to the session libgdb selected for the faulting inferior */
+    select_session(tctx, gdb_selected_session(tctx->ctx));
+
+    /* An empty output means there is nothing to report yet (e.g. a dprintf), so the rest of the
+       system can keep running. In non-stop mode libgdb has already stopped just the faulting thread
+       and suspend_system() leaves everything else alone. libgdb queues any further stops until GDB
+       has dealt with this one. */
+    if (tctx->fault_output[0] != 0) {
+        suspend_system(tctx->ctx);
+        strlcpy(tctx->link->stop_reply, tctx->fault_output, BUFSIZE);
+    }
+
+    /* Console output stays buffered in libgdb until GDB has connected */
+    if (tctx->link->transport != NULL) {
+        send_pending(tctx);
+        tctx->link->transport->flush(tctx->link->transport->cookie);
+    }
+
+    return err;
+}
@@ -184,6 +184,15 @@ char *hexstr_to_int(char *hex_str, int max_bytes, seL4_Word *val)
     return hex_str;
 }
 
+char *decstr_to_int(char *dec_str, seL4_Word *val)
+{
+    while (*dec_str >= '0' && *dec_str <= '9') {
+        *val = (*val * 10) + (*dec_str - '0');
+        dec_str++;
+    }
+    return dec_str;
+}
+
 /* Convert a buffer to a hexadecimal string */
 char *mem2hex(char *mem, char *buf, int size) {
     int i;
@@ -209,3 +218,20 @@ char *hex2mem(char *buf, char *mem, int size) {
     }
     return buf;
 }
+
+uint64_t read_cycle_counter(void) {
+#if defined(__aarch64__) && (defined(CONFIG_EXPORT_VCNT_USR) || defined(GDB_CYCLE_COUNTER))
+    uint64_t value;
+    __asm__ volatile("mrs %0, cntvct_el0" : "=r"(value));
+    return value;
+#elif defined(__aarch64__) && defined(CONFIG_EXPORT_PCNT_USR)
+    uint64_t value;
+    __asm__ volatile("mrs %0, cntpct_el0" : "=r"(value));
+    return value;
+#elif defined(__x86_64__)
+    /* The host build */
+    return __builtin_ia32_rdtsc();
+#else
+    return 0;
+#endif
+}
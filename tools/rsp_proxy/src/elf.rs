@@ -0,0 +1,101 @@
+/*
+ * Copyright 2025, UNSW
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+/*
+ * Just enough ELF parsing to find the read-only loadable segments of a PD's image. Only 64-bit
+ * little-endian images are supported, as that is all libgdb debugs.
+ */
+
+use std::fs;
+use std::io::{self, Error, ErrorKind};
+
+const PT_LOAD: u32 = 1;
+const PF_W: u32 = 2;
+
+struct Segment {
+    vaddr: u64,
+    /* Only the part of the segment that comes from the file. The rest is zero-filled at load time. */
+    data: Vec<u8>,
+}
+
+pub struct Image {
+    segments: Vec<Segment>,
+}
+
+fn u16_at(b: &[u8], off: usize) -> u16 {
+    u16::from_le_bytes(b[off..off + 2].try_into().unwrap())
+}
+
+fn u32_at(b: &[u8], off: usize) -> u32 {
+    u32::from_le_bytes(b[off..off + 4].try_into().unwrap())
+}
+
+fn u64_at(b: &[u8], off: usize) -> u64 {
+    u64::from_le_bytes(b[off..off + 8].try_into().unwrap())
+}
+
+fn invalid(msg: &str) -> Error {
+    Error::new(ErrorKind::InvalidData, msg.to_string())
+}
+
+impl Image {
+    pub fn load(path: &str) -> io::Result<Image> {
+        let file = fs::read(path)?;
+        if file.len() < 64 || &file[0..4] != b"\x7fELF" {
+            return Err(invalid("not an ELF file"));
+        }
+        /* ELFCLASS64, ELFDATA2LSB */
+        if file[4] != 2 || file[5] != 1 {
+            return Err(invalid("only 64-bit little-endian ELF files are supported"));
+        }
+
+        let phoff = u64_at(&file, 0x20) as usize;
+        let phentsize = u16_at(&file, 0x36) as usize;
+        let phnum = u16_at(&file, 0x38) as usize;
+
+        let mut segments = Vec::new();
+        for i in 0..phnum {
+            let ph = phoff + i * phentsize;
+            if ph + 56 > file.len() {
+                return Err(invalid("truncated program headers"));
+            }
+
+            let p_type = u32_at(&file, ph);
+            let p_flags = u32_at(&file, ph + 4);
+            if p_type != PT_LOAD || p_flags & PF_W != 0 {
+                continue;
+            }
+
+            let offset = u64_at(&file, ph + 8) as usize;
+            let vaddr = u64_at(&file, ph + 16);
+            let filesz = u64_at(&file, ph + 32) as usize;
+            if offset + filesz > file.len() {
+                return Err(invalid("segment extends past the end of the file"));
+            }
+
+            segments.push(Segment { vaddr, data: file[offset..offset + filesz].to_vec() });
+        }
+
+        Ok(Image { segments })
+    }
+
+    /* The bytes at [addr, addr + len), if they all come from a single read-only segment */
+    pub fn read(&self, addr: u64, len: u64) -> Option<&[u8]> {
+        self.segments.iter().find_map(|seg| {
+            let end = addr.checked_add(len)?;
+            if addr >= seg.vaddr && end <= seg.vaddr + seg.data.len() as u64 {
+                let start = (addr - seg.vaddr) as usize;
+                Some(&seg.data[start..start + len as usize])
+            } else {
+                None
+            }
+        })
+    }
+
+    pub fn read_only_size(&self) -> usize {
+        self.segments.iter().map(|seg| seg.data.len()).sum()
+    }
+}
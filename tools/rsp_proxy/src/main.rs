@@ -0,0 +1,329 @@
+/*
+ * Copyright 2025, UNSW
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+/*
+ * A proxy that sits between GDB and the debugger. Reads of memory that comes from a read-only
+ * segment of a PD's ELF file (e.g. .text and .rodata) are answered from the file on the host, and
+ * everything else is passed on to the target. The proxy does the acks on each side itself, so a
+ * packet it answers never goes near the target.
+ */
+
+mod elf;
+mod packet;
+
+use std::collections::HashMap;
+use std::fs::OpenOptions;
+use std::io::{self, Read, Write};
+use std::net::{TcpListener, TcpStream};
+use std::sync::{Arc, Mutex};
+use std::{env, process, thread};
+
+use packet::Event;
+
+struct Inferior {
+    image: elf::Image,
+    /* Ranges that may no longer match the file, e.g. where a software breakpoint was inserted */
+    dirty: Vec<(u64, u64)>,
+}
+
+struct Proxy {
+    /* Keyed by the process id GDB uses for the inferior */
+    inferiors: HashMap<u64, Inferior>,
+    /* The process memory accesses currently go to (set by Hg and by stop replies) */
+    current_pid: u64,
+    /* The target is only assumed to support 'x' once it has answered one itself */
+    target_supports_x: bool,
+    /* The last request passed on to the target, which its next reply is for */
+    outstanding: Vec<u8>,
+
+    gdb: Option<TcpStream>,
+    last_to_gdb: Vec<u8>,
+    target: Box<dyn Write + Send>,
+    last_to_target: Vec<u8>,
+
+    cached_reads: u64,
+    forwarded_reads: u64,
+}
+
+fn usage() -> ! {
+    eprintln!("usage: rsp_proxy --target <host:port|device> [--listen <port>] [--elf <pid>=<file>]...");
+    process::exit(1);
+}
+
+fn parse_hex(s: &[u8]) -> Option<u64> {
+    u64::from_str_radix(std::str::from_utf8(s).ok()?, 16).ok()
+}
+
+/* Parse "addr,len" up to the first byte that is not part of it */
+fn parse_addr_len(s: &[u8]) -> Option<(u64, u64)> {
+    let comma = s.iter().position(|&b| b == b',')?;
+    let end = s.iter().position(|&b| b == b':' || b == b';').unwrap_or(s.len());
+    Some((parse_hex(&s[..comma])?, parse_hex(&s[comma + 1..end])?))
+}
+
+/* The process id out of a "p<pid>.<tid>" thread id */
+fn parse_pid(s: &[u8]) -> Option<u64> {
+    let s = s.strip_prefix(b"p")?;
+    let end = s.iter().position(|&b| b == b'.' || b == b';').unwrap_or(s.len());
+    parse_hex(&s[..end])
+}
+
+fn overlaps(ranges: &[(u64, u64)], start: u64, end: u64) -> bool {
+    ranges.iter().any(|&(s, e)| start < e && s < end)
+}
+
+impl Proxy {
+    fn send_to_gdb(&mut self, pkt: Vec<u8>) {
+        if let Some(gdb) = self.gdb.as_mut() {
+            let _ = gdb.write_all(&pkt);
+        }
+        self.last_to_gdb = pkt;
+    }
+
+    fn send_to_target(&mut self, pkt: Vec<u8>) {
+        self.target.write_all(&pkt).expect("Could not write to target");
+        self.last_to_target = pkt;
+    }
+
+    /* Answer a memory read from the ELF file, if it only covers read-only memory that hasn't changed */
+    fn read_locally(&self, pkt: &[u8]) -> Option<Vec<u8>> {
+        let binary = match pkt.first()? {
+            b'm' => false,
+            b'x' if self.target_supports_x => true,
+            _ => return None,
+        };
+
+        let (addr, len) = parse_addr_len(&pkt[1..])?;
+        let inferior = self.inferiors.get(&self.current_pid)?;
+        if overlaps(&inferior.dirty, addr, addr.checked_add(len)?) {
+            return None;
+        }
+        let data = inferior.image.read(addr, len)?;
+
+        let mut reply = Vec::with_capacity(data.len() * 2 + 1);
+        if binary {
+            reply.push(b'b');
+            packet::escape(data, &mut reply);
+        } else {
+            for b in data {
+                reply.extend_from_slice(format!("{:02x}", b).as_bytes());
+            }
+        }
+        Some(reply)
+    }
+
+    /* Keep track of what a request from GDB does to the target's memory and which process it is for */
+    fn observe_request(&mut self, pkt: &[u8]) {
+        let written = match pkt {
+            [b'M', rest @ ..] | [b'X', rest @ ..] => parse_addr_len(rest),
+            /* A software breakpoint replaces the instruction at addr, and kind is its length */
+            [b'Z', b'0', b',', rest @ ..] => parse_addr_len(rest),
+            [b'H', b'g', rest @ ..] => {
+                if let Some(pid) = parse_pid(rest) {
+                    if pid > 0 {
+                        self.current_pid = pid;
+                    }
+                }
+                None
+            }
+            _ => None,
+        };
+
+        if let Some((addr, len)) = written {
+            if let Some(inferior) = self.inferiors.get_mut(&self.current_pid) {
+                inferior.dirty.push((addr, addr.saturating_add(len)));
+            }
+        }
+    }
+
+    /* Stop replies and qC change the thread (and so the process) the target is looking at */
+    fn observe_reply(&mut self, pkt: &[u8]) {
+        let thread = if let Some(rest) = pkt.strip_prefix(b"QC") {
+            Some(rest)
+        } else if pkt.first() == Some(&b'T') || pkt.starts_with(b"Stop:T") {
+            pkt.windows(7).position(|w| w == b"thread:").map(|i| &pkt[i + 7..])
+        } else {
+            None
+        };
+        if let Some(pid) = thread.and_then(parse_pid) {
+            self.current_pid = pid;
+        }
+
+        if self.outstanding.first() == Some(&b'x') && !pkt.is_empty() && pkt[0] != b'E' {
+            self.target_supports_x = true;
+        }
+    }
+
+    fn handle_gdb_event(&mut self, event: Event) {
+        match event {
+            Event::Packet(pkt) => {
+                if let Some(gdb) = self.gdb.as_mut() {
+                    let _ = gdb.write_all(b"+");
+                }
+
+                if let Some(reply) = self.read_locally(&pkt) {
+                    self.cached_reads += 1;
+                    self.send_to_gdb(packet::frame(b'$', &reply));
+                    return;
+                }
+
+                if matches!(pkt.first(), Some(b'm') | Some(b'x')) {
+                    self.forwarded_reads += 1;
+                }
+                self.observe_request(&pkt);
+                self.send_to_target(packet::frame(b'$', &pkt));
+                self.outstanding = pkt;
+            }
+            Event::Nack => {
+                let pkt = self.last_to_gdb.clone();
+                self.send_to_gdb(pkt);
+            }
+            Event::BadChecksum => {
+                if let Some(gdb) = self.gdb.as_mut() {
+                    let _ = gdb.write_all(b"-");
+                }
+            }
+            Event::Interrupt => self.target.write_all(&[0x03]).expect("Could not write to target"),
+            /* Acks for what we sent, and notifications (which GDB never sends) */
+            Event::Ack | Event::Notification(_) => (),
+        }
+    }
+
+    fn handle_target_event(&mut self, event: Event) {
+        match event {
+            Event::Packet(pkt) => {
+                self.target.write_all(b"+").expect("Could not write to target");
+                self.observe_reply(&pkt);
+                self.outstanding.clear();
+                self.send_to_gdb(packet::frame(b'$', &pkt));
+            }
+            Event::Notification(pkt) => {
+                self.observe_reply(&pkt);
+                if let Some(gdb) = self.gdb.as_mut() {
+                    let _ = gdb.write_all(&packet::frame(b'%', &pkt));
+                }
+            }
+            Event::Nack => {
+                let pkt = self.last_to_target.clone();
+                self.send_to_target(pkt);
+            }
+            Event::BadChecksum => self.target.write_all(b"-").expect("Could not write to target"),
+            Event::Ack | Event::Interrupt => (),
+        }
+    }
+}
+
+fn main() {
+    let mut target_addr = None;
+    let mut listen_port = 2345;
+    let mut inferiors = HashMap::new();
+
+    let mut args = env::args().skip(1);
+    while let Some(arg) = args.next() {
+        let value = args.next().unwrap_or_else(|| usage());
+        match arg.as_str() {
+            "--target" => target_addr = Some(value),
+            "--listen" => listen_port = value.parse().unwrap_or_else(|_| usage()),
+            "--elf" => {
+                let (pid, path) = value.split_once('=').unwrap_or_else(|| usage());
+                let pid = pid.parse().unwrap_or_else(|_| usage());
+                let image = elf::Image::load(path).unwrap_or_else(|e| {
+                    eprintln!("Failed to load {}: {}", path, e);
+                    process::exit(1);
+                });
+                println!("Serving {} bytes of read-only memory for process {} from {}", image.read_only_size(), pid, path);
+                inferiors.insert(pid, Inferior { image, dirty: Vec::new() });
+            }
+            _ => usage(),
+        }
+    }
+    let target_addr = target_addr.unwrap_or_else(|| usage());
+
+    /* The target is either reached over TCP or is a serial device (or serial_demux's virtual one) */
+    let (mut target_rx, target_tx): (Box<dyn Read + Send>, Box<dyn Write + Send>) = if target_addr.contains(':') {
+        let stream = TcpStream::connect(&target_addr).expect("Failed to connect to target");
+        stream.set_nodelay(true).expect("Failed to set TCP_NODELAY");
+        (Box::new(stream.try_clone().expect("Failed to clone")), Box::new(stream))
+    } else {
+        let file = OpenOptions::new().read(true).write(true).open(&target_addr).expect("Failed to open target");
+        (Box::new(file.try_clone().expect("Failed to clone")), Box::new(file))
+    };
+
+    let proxy = Arc::new(Mutex::new(Proxy {
+        inferiors,
+        current_pid: 1,
+        target_supports_x: false,
+        outstanding: Vec::new(),
+        gdb: None,
+        last_to_gdb: Vec::new(),
+        target: target_tx,
+        last_to_target: Vec::new(),
+        cached_reads: 0,
+        forwarded_reads: 0,
+    }));
+
+    /* Handle the target -> gdb direction */
+    let target_proxy = proxy.clone();
+    thread::spawn(move || {
+        let mut reader = packet::Reader::new();
+        let mut buffer = vec![0u8; 64 * 1024];
+        let mut events = Vec::new();
+        loop {
+            let n = match target_rx.read(&mut buffer) {
+                Ok(0) => {
+                    println!("Target closed the connection");
+                    process::exit(0);
+                }
+                Ok(n) => n,
+                Err(ref e) if e.kind() == io::ErrorKind::Interrupted => continue,
+                Err(e) => panic!("target -> gdb: Failed with: {:?}", e),
+            };
+
+            reader.feed(&buffer[..n], &mut events);
+            let mut proxy = target_proxy.lock().unwrap();
+            for event in events.drain(..) {
+                proxy.handle_target_event(event);
+            }
+        }
+    });
+
+    /* Handle the gdb -> target direction, one GDB connection at a time */
+    let listener = TcpListener::bind(("127.0.0.1", listen_port)).expect("Failed to listen");
+    println!("GDB should connect to localhost:{}", listen_port);
+    for stream in listener.incoming() {
+        let mut stream = match stream {
+            Ok(stream) => stream,
+            Err(_) => continue,
+        };
+        stream.set_nodelay(true).expect("Failed to set TCP_NODELAY");
+        {
+            let mut proxy = proxy.lock().unwrap();
+            proxy.gdb = Some(stream.try_clone().expect("Failed to clone"));
+            proxy.outstanding.clear();
+        }
+
+        let mut reader = packet::Reader::new();
+        let mut buffer = vec![0u8; 64 * 1024];
+        let mut events = Vec::new();
+        loop {
+            let n = match stream.read(&mut buffer) {
+                Ok(0) | Err(_) => break,
+                Ok(n) => n,
+            };
+
+            reader.feed(&buffer[..n], &mut events);
+            let mut proxy = proxy.lock().unwrap();
+            for event in events.drain(..) {
+                proxy.handle_gdb_event(event);
+            }
+        }
+
+        let mut proxy = proxy.lock().unwrap();
+        println!("GDB disconnected. {} memory reads answered locally, {} passed on to the target",
+                 proxy.cached_reads, proxy.forwarded_reads);
+        proxy.gdb = None;
+    }
+}
@@ -0,0 +1,126 @@
+/*
+ * Copyright 2025, UNSW
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+/*
+ * Framing for GDB's remote serial protocol. Payloads are kept exactly as they were sent (escapes and
+ * run-length encoding included) so that anything the proxy doesn't look at is passed on untouched.
+ */
+
+pub enum Event {
+    Ack,
+    Nack,
+    /* Ctrl-C from GDB */
+    Interrupt,
+    BadChecksum,
+    Packet(Vec<u8>),
+    Notification(Vec<u8>),
+}
+
+#[derive(Clone, Copy, PartialEq, Eq)]
+enum State {
+    Idle,
+    Payload,
+    Escape,
+    ChecksumHi,
+    ChecksumLo,
+}
+
+pub struct Reader {
+    state: State,
+    notification: bool,
+    payload: Vec<u8>,
+    checksum: u8,
+}
+
+fn hex_value(c: u8) -> Option<u8> {
+    (c as char).to_digit(16).map(|d| d as u8)
+}
+
+pub fn checksum(payload: &[u8]) -> u8 {
+    payload.iter().fold(0u8, |sum, &b| sum.wrapping_add(b))
+}
+
+/* Frame a packet ('$') or notification ('%') */
+pub fn frame(start: u8, payload: &[u8]) -> Vec<u8> {
+    let mut out = Vec::with_capacity(payload.len() + 4);
+    out.push(start);
+    out.extend_from_slice(payload);
+    out.extend_from_slice(format!("#{:02x}", checksum(payload)).as_bytes());
+    out
+}
+
+/* Escape binary data for a packet payload */
+pub fn escape(data: &[u8], out: &mut Vec<u8>) {
+    for &b in data {
+        if matches!(b, b'#' | b'$' | b'}' | b'*') {
+            out.push(b'}');
+            out.push(b ^ 0x20);
+        } else {
+            out.push(b);
+        }
+    }
+}
+
+impl Reader {
+    pub fn new() -> Reader {
+        Reader { state: State::Idle, notification: false, payload: Vec::new(), checksum: 0 }
+    }
+
+    pub fn feed(&mut self, data: &[u8], events: &mut Vec<Event>) {
+        for &byte in data {
+            match self.state {
+                State::Idle => match byte {
+                    b'$' | b'%' => {
+                        self.notification = byte == b'%';
+                        self.payload.clear();
+                        self.state = State::Payload;
+                    }
+                    b'+' => events.push(Event::Ack),
+                    b'-' => events.push(Event::Nack),
+                    0x03 => events.push(Event::Interrupt),
+                    /* Anything else between packets is noise */
+                    _ => (),
+                },
+                State::Payload => match byte {
+                    b'#' => self.state = State::ChecksumHi,
+                    b'}' => {
+                        self.payload.push(byte);
+                        self.state = State::Escape;
+                    }
+                    _ => self.payload.push(byte),
+                },
+                State::Escape => {
+                    self.payload.push(byte);
+                    self.state = State::Payload;
+                }
+                State::ChecksumHi => match hex_value(byte) {
+                    Some(hi) => {
+                        self.checksum = hi << 4;
+                        self.state = State::ChecksumLo;
+                    }
+                    None => {
+                        self.state = State::Idle;
+                        events.push(Event::BadChecksum);
+                    }
+                },
+                State::ChecksumLo => {
+                    self.state = State::Idle;
+                    match hex_value(byte) {
+                        Some(lo) if self.checksum | lo == checksum(&self.payload) => {
+                            let payload = std::mem::take(&mut self.payload);
+                            events.push(if self.notification {
+                                Event::Notification(payload)
+                            } else {
+                                Event::Packet(payload)
+                            });
+                        }
+                        _ => events.push(Event::BadChecksum),
+                    }
+                }
+            }
+        }
+    }
+}
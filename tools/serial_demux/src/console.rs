@@ -0,0 +1,174 @@
+/*
+ * Copyright 2025, UNSW
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+/*
+ * Console output from the target, split into streams by the prefix each line starts with (e.g. the
+ * "ping|" that a PD puts on everything it prints). Each stream has its own timestamped output and its
+ * own writer thread, so a stream whose reader is slow or absent never holds up GDB's packets or the
+ * other streams.
+ */
+
+use std::fs;
+use std::io::{self, Write};
+use std::os::unix::net::{UnixListener, UnixStream};
+use std::sync::mpsc::{self, Receiver, SyncSender, TrySendError};
+use std::sync::{Arc, Mutex};
+use std::thread;
+use std::time::Instant;
+use serialport::{SerialPort, TTYPort};
+
+/* Number of chunks a stream can fall behind by before its output is dropped */
+const STREAM_BACKLOG: usize = 1024;
+
+pub enum Sink {
+    Stdout,
+    Pty,
+    Socket,
+}
+
+pub struct StreamConfig {
+    pub name: String,
+    pub prefix: Vec<u8>,
+    pub sink: Sink,
+}
+
+struct Stream {
+    prefix: Vec<u8>,
+    tx: SyncSender<Vec<u8>>,
+    /* Output for this stream from the data currently being routed */
+    pending: Vec<u8>,
+    dropped: bool,
+}
+
+pub struct Router {
+    /* The last stream is the default one, for lines that don't match any prefix */
+    streams: Vec<Stream>,
+    longest_prefix: usize,
+    /* The start of the current line, until it is long enough to tell which stream it belongs to */
+    line_start: Vec<u8>,
+    current: Option<usize>,
+    start_time: Instant,
+}
+
+impl Router {
+    pub fn new(configs: Vec<StreamConfig>) -> io::Result<Router> {
+        let mut streams = Vec::new();
+        for config in configs.into_iter().chain(std::iter::once(StreamConfig {
+            name: String::from("console"),
+            prefix: Vec::new(),
+            sink: Sink::Stdout,
+        })) {
+            let (tx, rx) = mpsc::sync_channel(STREAM_BACKLOG);
+            spawn_writer(&config, rx)?;
+            streams.push(Stream { prefix: config.prefix, tx, pending: Vec::new(), dropped: false });
+        }
+
+        let longest_prefix = streams.iter().map(|s| s.prefix.len()).max().unwrap_or(0);
+        Ok(Router {
+            streams,
+            longest_prefix,
+            line_start: Vec::new(),
+            current: None,
+            start_time: Instant::now(),
+        })
+    }
+
+    /* Route console output to its streams. Each stream gets whatever this produced for it in one go. */
+    pub fn feed(&mut self, data: &[u8]) {
+        for &byte in data {
+            match self.current {
+                Some(idx) => self.streams[idx].pending.push(byte),
+                None => {
+                    self.line_start.push(byte);
+                    if byte == b'\n' || self.line_start.len() >= self.longest_prefix.max(1) {
+                        self.start_line();
+                    }
+                }
+            }
+
+            if byte == b'\n' {
+                self.current = None;
+            }
+        }
+
+        for stream in self.streams.iter_mut() {
+            if stream.pending.is_empty() {
+                continue;
+            }
+
+            match stream.tx.try_send(std::mem::take(&mut stream.pending)) {
+                Ok(()) => stream.dropped = false,
+                Err(TrySendError::Full(_)) => {
+                    if !stream.dropped {
+                        eprintln!("serial_demux: a console stream is not keeping up, dropping its output");
+                        stream.dropped = true;
+                    }
+                }
+                Err(TrySendError::Disconnected(_)) => (),
+            }
+        }
+    }
+
+    /* Work out which stream the current line goes to, and start it off with a timestamp */
+    fn start_line(&mut self) {
+        let default = self.streams.len() - 1;
+        let idx = self.streams[..default].iter()
+                                         .position(|s| self.line_start.starts_with(&s.prefix))
+                                         .unwrap_or(default);
+
+        let elapsed = self.start_time.elapsed();
+        let stream = &mut self.streams[idx];
+        write!(stream.pending, "[{:5}.{:06}] ", elapsed.as_secs(), elapsed.subsec_micros()).unwrap();
+        stream.pending.append(&mut self.line_start);
+        self.current = Some(idx);
+    }
+}
+
+fn spawn_writer(config: &StreamConfig, rx: Receiver<Vec<u8>>) -> io::Result<()> {
+    match config.sink {
+        Sink::Stdout => {
+            thread::spawn(move || {
+                for chunk in rx {
+                    let mut stdout = io::stdout().lock();
+                    let _ = stdout.write_all(&chunk).and_then(|_| stdout.flush());
+                }
+            });
+        }
+        Sink::Pty => {
+            let (mut master, slave) = TTYPort::pair()?;
+            println!("Console stream '{}' is on {:?}", config.name, slave.name().expect("This should have a name"));
+            thread::spawn(move || {
+                /* The slave has to stay open, otherwise writes fail while nothing has it open */
+                let _slave = slave;
+                for chunk in rx {
+                    let _ = master.write_all(&chunk);
+                }
+            });
+        }
+        Sink::Socket => {
+            let path = format!("/tmp/serial_demux-{}.sock", config.name);
+            let _ = fs::remove_file(&path);
+            let listener = UnixListener::bind(&path)?;
+            println!("Console stream '{}' is on the socket {}", config.name, path);
+
+            /* Every connected client gets everything written after it connected */
+            let clients: Arc<Mutex<Vec<UnixStream>>> = Arc::new(Mutex::new(Vec::new()));
+            let accepted = clients.clone();
+            thread::spawn(move || {
+                for client in listener.incoming().flatten() {
+                    accepted.lock().unwrap().push(client);
+                }
+            });
+            thread::spawn(move || {
+                for chunk in rx {
+                    clients.lock().unwrap().retain_mut(|client| client.write_all(&chunk).is_ok());
+                }
+            });
+        }
+    }
+
+    Ok(())
+}
@@ -4,69 +4,123 @@
  * SPDX-License-Identifier: BSD-2-Clause
  */
 
-use std::{env, thread};
+mod console;
+mod rsp;
+
+use std::{env, process, thread};
 use std::io::{self, Read, Write};
+use std::time::Duration;
 use serialport::{SerialPort, TTYPort};
 
+/* Big enough to take everything that arrives at a few Mbaud between two reads */
+const BUFFER_SIZE: usize = 64 * 1024;
+
+/* Reads block for up to this long, rather than returning straight away and spinning */
+const READ_TIMEOUT: Duration = Duration::from_secs(3600);
+
+/* How long to back off for after an error, e.g. while GDB has not opened the virtual port yet */
+const ERROR_BACKOFF: Duration = Duration::from_millis(100);
+
+fn usage() -> ! {
+    eprintln!("usage: serial_demux <serial_device> <baud_rate> [--socket] [--stream <name>=<prefix>]...");
+    process::exit(1);
+}
+
 fn main() {
-    let args : Vec<String> = env::args().collect();
-    let real_serial = &args[1];
-    let baud_rate = &args[2];
+    let mut positional = Vec::new();
+    let mut streams = Vec::new();
+    let mut use_sockets = false;
+
+    let mut args = env::args().skip(1);
+    while let Some(arg) = args.next() {
+        if arg == "--socket" {
+            use_sockets = true;
+        } else if arg == "--stream" {
+            let spec = args.next().unwrap_or_else(|| usage());
+            let (name, prefix) = spec.split_once('=').unwrap_or_else(|| usage());
+            streams.push((name.to_string(), prefix.as_bytes().to_vec()));
+        } else {
+            positional.push(arg);
+        }
+    }
+    if positional.len() != 2 {
+        usage();
+    }
+    let real_serial = &positional[0];
+    let baud_rate = &positional[1];
 
     let (mut master_tx, slave) = TTYPort::pair().expect("Unable to create a pseudo-terminal");
+    master_tx.set_timeout(READ_TIMEOUT).expect("Failed to set timeout");
     let mut master_rx = master_tx.try_clone().expect("Failed to clone");
 
     println!("Virtual serial port created. GDB should connect to the file {:?}", slave.name().expect("This should have a name"));
 
-    let mut port_rx = serialport::new(real_serial, baud_rate.parse().unwrap()).open().expect("Failed to open port");
+    let mut port_rx = serialport::new(real_serial, baud_rate.parse().unwrap())
+                                 .timeout(READ_TIMEOUT)
+                                 .open()
+                                 .expect("Failed to open port");
     let mut port_tx = port_rx.try_clone().expect("Failed to clone");
 
+    /* Console lines starting with one of the prefixes go to their own stream, and the rest to stdout */
+    let configs = streams.into_iter().map(|(name, prefix)| console::StreamConfig {
+        name,
+        prefix,
+        sink: if use_sockets { console::Sink::Socket } else { console::Sink::Pty },
+    }).collect();
+    let mut router = console::Router::new(configs).expect("Failed to set up console streams");
+
+    /* Acks from the target are told apart from console output by the packets GDB has sent */
+    let pending_acks = rsp::PendingAcks::new();
+    let sent_by_gdb = pending_acks.clone();
+
     /* Handle the port -> gdb direction */
     let handle = thread::spawn(move || {
-        let mut in_gdb_packet = false;
-        let mut gdb_checksum_counter = 0;
-        let mut buffer: [u8; 1] = [0];
+        let mut demux = rsp::Demux::new(pending_acks);
+        let mut buffer = vec![0u8; BUFFER_SIZE];
+        let mut gdb = Vec::with_capacity(BUFFER_SIZE);
+        let mut console = Vec::with_capacity(BUFFER_SIZE);
         loop {
             match port_rx.read(&mut buffer) {
                 Ok(n) => {
-                    if n == 1 {
-                        if buffer[0] as char == '$' {
-                            in_gdb_packet = true;
-                        } else if buffer[0] as char == '#' && in_gdb_packet {
-                            in_gdb_packet = false;
-                            /* @alwin: this is kinda ugly*/
-                            gdb_checksum_counter = 3;
-                        }
-
-                        if in_gdb_packet || gdb_checksum_counter > 0 || buffer[0] as char == '+' || buffer[0] as char == '-' {
-                            master_tx.write(&buffer).expect("Could not write to master");
-                            if gdb_checksum_counter > 0 {
-                                gdb_checksum_counter -= 1;
-                            }
-                        } else {
-                            print!("{}", buffer[0] as char);
-
-                        }
+                    demux.feed(&buffer[..n], &mut gdb, &mut console);
+
+                    /* Everything GDB is to get from this read goes out in a single write */
+                    if !gdb.is_empty() {
+                        master_tx.write_all(&gdb).expect("Could not write to master");
+                        gdb.clear();
+                    }
+
+                    /* Console output is written by other threads, so it never holds GDB up */
+                    if !console.is_empty() {
+                        router.feed(&console);
+                        console.clear();
                     }
                 },
                 Err(ref e) if e.kind() == io::ErrorKind::TimedOut => (),
-                Err(e) => println!("port -> gdb: Failed with: {:?}", e),
+                Err(e) => {
+                    println!("port -> gdb: Failed with: {:?}", e);
+                    thread::sleep(ERROR_BACKOFF);
+                }
             }
         }
     });
 
-    /* Handle the gdb -> port direction */
+    /* Handle the gdb -> port direction. GDB writes a whole packet at a time, so it is passed on as it
+       is read. */
     thread::spawn(move || {
-        let mut buffer: [u8; 1] = [0];
+        let mut buffer = vec![0u8; BUFFER_SIZE];
         loop {
             match master_rx.read(&mut buffer) {
                 Ok(n) => {
-                    if n == 1 {
-                        port_tx.write(&buffer).expect("Could not write to port\n");
-                    }
+                    /* Counted before the target can see them, so their acks are never taken for console output */
+                    sent_by_gdb.sent(&buffer[..n]);
+                    port_tx.write_all(&buffer[..n]).expect("Could not write to port\n");
                 }
                 Err(ref e) if e.kind() == io::ErrorKind::TimedOut => (),
-                Err(e) => println!("gdb -> port: Failed with: {:?}", e),
+                Err(e) => {
+                    println!("gdb -> port: Failed with: {:?}", e);
+                    thread::sleep(ERROR_BACKOFF);
+                }
             }
         }
     });
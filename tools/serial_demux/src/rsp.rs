@@ -0,0 +1,164 @@
+/*
+ * Copyright 2025, UNSW
+ *
+ * SPDX-License-Identifier: BSD-2-Clause
+ */
+
+/*
+ * Splits the byte stream coming from the target into GDB traffic and console output. This follows
+ * the RSP framing rather than just looking for '$' and '#', so escaped bytes ('}' followed by the
+ * byte XOR 0x20) and run-length encoding ('*' followed by a repeat count) in a packet's payload are
+ * never mistaken for the end of the packet.
+ */
+
+use std::sync::Arc;
+use std::sync::atomic::{AtomicUsize, Ordering};
+
+/* Every notification the target can send is a stop notification */
+const NOTIFICATION_PREFIX: &[u8] = b"%Stop:";
+
+/*
+ * The number of packets GDB has sent that the target has not acked yet. The target only sends an ack
+ * in answer to one of GDB's packets, so a '+' or '-' is only taken to be an ack while this is
+ * non-zero. Any other '+' or '-' is console output.
+ */
+#[derive(Clone)]
+pub struct PendingAcks(Arc<AtomicUsize>);
+
+impl PendingAcks {
+    pub fn new() -> PendingAcks {
+        PendingAcks(Arc::new(AtomicUsize::new(0)))
+    }
+
+    /* Count the packets in data written by GDB. GDB escapes any '$' in a packet's payload, so each
+       one starts a packet. */
+    pub fn sent(&self, data: &[u8]) {
+        let packets = data.iter().filter(|&&b| b == b'$').count();
+        if packets > 0 {
+            self.0.fetch_add(packets, Ordering::AcqRel);
+        }
+    }
+
+    fn take(&self) -> bool {
+        self.0.fetch_update(Ordering::AcqRel, Ordering::Acquire, |n| n.checked_sub(1)).is_ok()
+    }
+}
+
+#[derive(Clone, Copy, PartialEq, Eq)]
+enum State {
+    /* Between packets, where anything that isn't GDB traffic is console output */
+    Idle,
+    /* Seen a '%', which is only the start of a notification if "Stop:" follows */
+    NotificationStart,
+    Payload,
+    /* The next byte is escaped, so it is part of the payload whatever it is */
+    Escape,
+    /* The next byte is a run-length count, which can be any printable character */
+    RunLength,
+    ChecksumHi,
+    ChecksumLo,
+}
+
+pub struct Demux {
+    state: State,
+    /* The packet being received, which is only passed on to GDB once it is complete */
+    packet: Vec<u8>,
+    pending_acks: PendingAcks,
+}
+
+impl Demux {
+    pub fn new(pending_acks: PendingAcks) -> Demux {
+        Demux { state: State::Idle, packet: Vec::with_capacity(4096), pending_acks }
+    }
+
+    /*
+     * Feed data read from the target. Complete packets and acks are appended to gdb, and console
+     * output to console, so that each can be written out in one go. A packet that is split across
+     * reads is held on to until the rest of it arrives.
+     */
+    pub fn feed(&mut self, data: &[u8], gdb: &mut Vec<u8>, console: &mut Vec<u8>) {
+        let mut i = 0;
+        while i < data.len() {
+            let byte = data[i];
+            match self.state {
+                State::Idle => {
+                    /* Most of what isn't GDB traffic is console output, so copy all of it at once */
+                    let end = data[i..].iter()
+                                       .position(|&b| matches!(b, b'$' | b'%' | b'+' | b'-'))
+                                       .map_or(data.len(), |n| i + n);
+                    console.extend_from_slice(&data[i..end]);
+                    i = end;
+                    if i == data.len() {
+                        break;
+                    }
+
+                    match data[i] {
+                        b'$' => self.start(State::Payload, data[i]),
+                        b'%' => self.start(State::NotificationStart, data[i]),
+                        ack if self.pending_acks.take() => gdb.push(ack),
+                        other => console.push(other),
+                    }
+                }
+                State::NotificationStart => {
+                    if byte == NOTIFICATION_PREFIX[self.packet.len()] {
+                        self.packet.push(byte);
+                        if self.packet.len() == NOTIFICATION_PREFIX.len() {
+                            self.state = State::Payload;
+                        }
+                    } else {
+                        /* Just a '%' in the console output. This byte is looked at again as console output. */
+                        console.extend_from_slice(&self.packet);
+                        self.packet.clear();
+                        self.state = State::Idle;
+                        continue;
+                    }
+                }
+                State::Payload => {
+                    /* Copy everything up to the next byte that means something to the framing */
+                    let end = data[i..].iter()
+                                       .position(|&b| matches!(b, b'}' | b'*' | b'#' | b'$'))
+                                       .map_or(data.len(), |n| i + n);
+                    self.packet.extend_from_slice(&data[i..end]);
+                    i = end;
+                    if i == data.len() {
+                        break;
+                    }
+
+                    match data[i] {
+                        b'}' => self.state = State::Escape,
+                        b'*' => self.state = State::RunLength,
+                        b'#' => self.state = State::ChecksumHi,
+                        /* An unescaped '$' can only mean the target started again part way through
+                           a packet, so drop what we have and start on the new one */
+                        _ => {
+                            self.packet.clear();
+                            self.state = State::Payload;
+                        }
+                    }
+                    self.packet.push(data[i]);
+                }
+                State::Escape | State::RunLength => {
+                    self.packet.push(byte);
+                    self.state = State::Payload;
+                }
+                State::ChecksumHi => {
+                    self.packet.push(byte);
+                    self.state = State::ChecksumLo;
+                }
+                State::ChecksumLo => {
+                    self.packet.push(byte);
+                    gdb.extend_from_slice(&self.packet);
+                    self.packet.clear();
+                    self.state = State::Idle;
+                }
+            }
+            i += 1;
+        }
+    }
+
+    fn start(&mut self, state: State, byte: u8) {
+        self.packet.clear();
+        self.packet.push(byte);
+        self.state = state;
+    }
+}